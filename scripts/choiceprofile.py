@@ -0,0 +1,100 @@
+#!/usr/bin/env python
+
+"""Rank the schedule selectors of a tuned program by the time spent in
+the schedules they chose.
+
+Run the program with --choiceprofile=PROFILE.csv first.  For each
+selector the report lists:
+  - the choice made in each power-of-two input size range;
+  - the config level (lvlK_rule / cutoff) that made the choice;
+  - the self and inclusive time of those calls.
+It flags decisions made at input sizes larger than any the config was
+trained on.
+
+Usage: choiceprofile.py PROFILE.csv [CONFIG.cfg] [--trained-max=N]
+
+The trained size is read from CONFIG.cfg.trained (written by sgatuner)
+when --trained-max is not given.
+
+"""
+
+import csv
+import os
+import sys
+
+import configtool
+
+MAXINT = 2147483647
+
+def loadProfile(filename):
+  rows = []
+  for r in csv.DictReader(open(filename)):
+    for k in ('choice', 'size_log2', 'calls', 'timed_calls', 'min_n', 'max_n'):
+      r[k] = int(r[k])
+    for k in ('seconds', 'self_seconds'):
+      r[k] = float(r[k])
+    rows.append(r)
+  return rows
+
+def levelFor(cfg, site, n):
+  '''the decision tree level of site that handles input size n, and its lower bound'''
+  if cfg is None:
+    return None, None
+  lvl = 1
+  lower = 0
+  while True:
+    cutoff = '%s_lvl%d_cutoff' % (site, lvl+1)
+    if cutoff not in cfg.keys() or n < cfg[cutoff] or cfg[cutoff] >= MAXINT:
+      return lvl, lower
+    lower = max(lower, cfg[cutoff])
+    lvl += 1
+
+def trainedMax(cfgfile, override):
+  if override is not None:
+    return override
+  if cfgfile and os.path.isfile(cfgfile+'.trained'):
+    return configtool.ConfigFile(cfgfile+'.trained')['max_input_size']
+  return None
+
+def report(rows, cfg, trained):
+  sites = {}
+  for r in rows:
+    sites.setdefault(r['site'], []).append(r)
+  ranked = sorted(sites.items(), key=lambda x: -sum(map(lambda r: r['self_seconds'], x[1])))
+  total = sum(map(lambda r: r['self_seconds'], rows)) or 1.0
+
+  for site, srows in ranked:
+    selfsec = sum(map(lambda r: r['self_seconds'], srows))
+    calls = sum(map(lambda r: r['calls'], srows))
+    print "%-30s %6.1f%%  self %.4fs  %d calls" % (site, 100.0*selfsec/total, selfsec, calls)
+    for r in sorted(srows, key=lambda r: (r['size_log2'], r['choice'])):
+      lvl, lower = levelFor(cfg, site, r['max_n'])
+      flags = []
+      if trained is not None and r['max_n'] > trained:
+        flags.append('UNTRAINED n>%d' % trained)
+      if trained is not None and lower is not None and lower > trained:
+        flags.append('level above trained sizes')
+      if r['timed_calls'] < r['calls']:
+        flags.append('%d untimed (parallel)' % (r['calls']-r['timed_calls']))
+      print "    n=%-15s choice %-3d %-6s %8d calls  self %.4fs  incl %.4fs  %s" % (
+          "%d-%d" % (r['min_n'], r['max_n']), r['choice'],
+          ('lvl%d' % lvl) if lvl else '', r['calls'],
+          r['self_seconds'], r['seconds'], ', '.join(flags))
+
+def main(argv):
+  trained = None
+  args = []
+  for a in argv:
+    if a.startswith('--trained-max='):
+      trained = int(a.split('=', 1)[1])
+    else:
+      args.append(a)
+  if len(args) < 1 or len(args) > 2:
+    print __doc__
+    sys.exit(1)
+  cfgfile = args[1] if len(args) > 1 else None
+  cfg = configtool.ConfigFile(cfgfile) if cfgfile else None
+  report(loadProfile(args[0]), cfg, trainedMax(cfgfile, trained))
+
+if __name__ == '__main__':
+  main(sys.argv[1:])
@@ -216,8 +216,12 @@ configctor = {'algchoice.alg'                 : None,#handled in selector creati
               'system.data.distribution.size' : Cutoff,
               'system.data.distribution.type' : Switch,
               'system.data.migration.type'    : Switch,
+              'system.flag.bisect'            : Switch,
               'system.flag.unrollschedule'    : Switch,
               'system.runtime.threads'        : Ignore,
+              'system.size.blocknumber'       : Switch,
+              'system.size.tile'              : Cutoff,
+              'system.size.unroll'            : Switch,
               'system.tunable.accuracy.array' : SynthesizedFunction,
               'user.tunable.accuracy.array'   : SynthesizedFunction,
               'user.tunable.array'            : SynthesizedFunction,
@@ -0,0 +1,85 @@
+#!/usr/bin/env python
+
+"""Measure the cost of --enable-large-index (64-bit IndexT) on multigrid.
+
+Builds a second, out-of-tree copy of petabricks configured with
+--enable-large-index, compiles the multigrid benchmarks with both pbc
+binaries and compares their run times.
+
+Usage: largeindexbench.py [benchmark ...]
+
+"""
+
+import os
+import subprocess
+import sys
+
+import pbutil
+
+TRIALS = 5
+BUILDDIR = "./build-largeindex"
+
+BENCHMARKS = [
+  ("multigrid/Poisson2DSOR",  1025),
+  ("multigrid/Poisson2DMG",   1025),
+  ("multigrid/Poisson2DFMG",  1025),
+  ("multigrid/Helmholtz3DMG",   65),
+]
+
+def buildLargeIndex():
+  root = os.getcwd()
+  if not os.path.isdir(BUILDDIR):
+    os.mkdir(BUILDDIR)
+  if not os.path.isfile(os.path.join(BUILDDIR, "Makefile")):
+    if subprocess.call([os.path.join(root, "configure"), "--enable-large-index"], cwd=BUILDDIR) != 0:
+      raise Exception("configure --enable-large-index failed")
+  if subprocess.call(["make", "-j%d" % pbutil.cpuCount()], cwd=BUILDDIR) != 0:
+    raise Exception("large index build failed")
+
+def pbcCommand(mode):
+  if mode == "int":
+    return ["./src/pbc"]
+  return [BUILDDIR+"/src/pbc",
+          "--libdir="+BUILDDIR+"/src",
+          "--runtimedir=./src"]
+
+def binaryName(benchmark, mode):
+  return pbutil.benchmarkToBin(benchmark)+"."+mode
+
+def compile(benchmark, mode):
+  cmd = pbcCommand(mode) + ["--output="+binaryName(benchmark, mode),
+                            pbutil.benchmarkToSrc(benchmark)]
+  NULL = open("/dev/null", "w")
+  rv = subprocess.call(cmd, stdout=NULL, stderr=NULL)
+  NULL.close()
+  if rv != 0:
+    raise Exception("compile failed: "+" ".join(cmd))
+
+def time(benchmark, mode, n):
+  return pbutil.executeTimingRun(binaryName(benchmark, mode), n,
+                                 ['--trials=%d' % TRIALS])['average']
+
+def main(args):
+  pbutil.chdirToPetabricksRoot()
+  pbutil.compilePetabricks()
+  buildLargeIndex()
+
+  benchmarks = BENCHMARKS
+  if args:
+    benchmarks = filter(lambda b: b[0] in args, BENCHMARKS)
+
+  print "%-28s %6s %12s %12s %8s" % ("benchmark", "n", "int", "long", "cost")
+  for benchmark, n in benchmarks:
+    times = dict()
+    for mode in ("int", "long"):
+      compile(benchmark, mode)
+      times[mode] = time(benchmark, mode, n)
+    print "%-28s %6d %12.6f %12.6f %7.1f%%" % (benchmark, n,
+                                              times["int"],
+                                              times["long"],
+                                              100.0*(times["long"]/times["int"]-1.0))
+    for mode in ("int", "long"):
+      os.unlink(binaryName(benchmark, mode))
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
@@ -3,6 +3,7 @@
 heuristics, and storing in the database the best one that is found"""
 import sys
 import os
+import errno
 import shutil
 import sqlite3
 import random
@@ -38,6 +39,7 @@ class HeuristicDB:
       self.__db = sqlite3.connect(":memory:")
     self.__createTables()
     self.__bestNCache= dict()
+    self.__openLog()
     
   def __createTable(self, name, params):
     cur = self.__db.cursor()
@@ -61,6 +63,44 @@ class HeuristicDB:
     dbPath= os.path.expanduser(config.output_dir+"/knowledge.db")
     return dbPath
 
+  def computeLogPath(self):
+    return os.path.expanduser(config.output_dir+"/knowledge.log")
+
+  def __openLog(self):
+    """Open the log of updates that pbc reads its heuristics from.
+Many learning compilers may append to it at the same time, so every update
+is a single write() of one line to an O_APPEND descriptor, which needs no
+lock.  A new log starts with the contents of the DB; it is created with
+O_EXCL so that when several compilers start together only one seeds it"""
+    logPath = self.computeLogPath()
+    flags = os.O_WRONLY|os.O_APPEND
+    try:
+      self.__log = os.open(logPath, flags|os.O_CREAT|os.O_EXCL, 0644)
+      isNew = True
+    except OSError, e:
+      self.__log = None
+      if e.errno != errno.EEXIST:
+        return
+      try:
+        self.__log = os.open(logPath, flags)
+      except OSError:
+        return
+      isNew = False
+    if isNew:
+      cur = self.__db.cursor()
+      query = "SELECT HeuristicKind.name, Heuristic.useCount, Heuristic.score, Heuristic.formula FROM Heuristic JOIN HeuristicKind ON Heuristic.kindID=HeuristicKind.ID"
+      cur.execute(query)
+      for name, useCount, score, formula in cur.fetchall():
+        self.__appendLog(name, useCount, score, formula)
+      cur.close()
+
+  def __appendLog(self, name, useCount, score, formula):
+    if self.__log is None:
+      return
+    assert "\t" not in name+formula and "\n" not in name+formula
+    line = "%s\t%d\t%.17g\t%s\n" % (name, useCount, score, formula)
+    os.write(self.__log, line)
+
   def getHeuristicKindID(self, kindName):
     cur = self.__db.cursor()
     query = "SELECT ID From HeuristicKind WHERE name='"+kindName+"'"
@@ -82,12 +122,15 @@ class HeuristicDB:
     cur = self.__db.cursor()
     query = "UPDATE Heuristic SET score=score+? WHERE kindID=? AND formula=?"
     cur.execute(query, (score, kindID, formula))
+    useCount = 0
     if cur.rowcount == 0:
       #There was no such heuristic in the DB: probably it was taken from the defaults
       query = "INSERT INTO Heuristic (kindID, formula, useCount, score) VALUES (?, ?, 1, ?)"
       cur.execute(query, (kindID, formula, score))
+      useCount = 1
     cur.close()
     self.__db.commit()
+    self.__appendLog(name, useCount, score, formula)
   
   def increaseHeuristicUseCount(self, name, formula):
     kindID=self.storeHeuristicKind(name) 
@@ -100,6 +143,7 @@ class HeuristicDB:
       cur.execute(query, (kindID, formula))
     cur.close()
     self.__db.commit()
+    self.__appendLog(name, 1, 0, formula)
   
   def increaseScore(self, hSet, score):
     """Mark a set of heuristics as selected as the best one for an executable"""
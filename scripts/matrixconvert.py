@@ -0,0 +1,101 @@
+#!/usr/bin/env python
+
+"""Convert matrix files between the text SIZE format and the binary .pbmat format.
+
+Usage: matrixconvert.py input output
+
+The direction is chosen from the extension of output: files ending in .pbmat
+are written in the binary format, anything else as text.  Binary files are
+written in native byte order with double precision elements; the runtime
+converts on read when its element type or byte order differs.
+
+"""
+
+import array
+import struct
+import sys
+
+MAGIC          = "\x89PBMATRX"
+FORMAT_VERSION = 1
+BYTEORDER      = 0x01020304
+TYPE_FLOAT     = ord('f')
+ALIGNMENT      = 4096
+MAX_DIMENSIONS = 64
+HEADER_FORMAT  = "=8s6IQ%dQ" % MAX_DIMENSIONS
+
+def readText(filename):
+  fd = open(filename)
+  header = fd.readline().split()
+  if not header or header[0] != "SIZE":
+    raise Exception("%s: expected SIZE header" % filename)
+  sizes = map(int, header[1:])
+  count = reduce(lambda x, y: x*y, sizes, 1)
+  values = map(float, fd.read().split())
+  fd.close()
+  if len(values) != count:
+    raise Exception("%s: expected %d elements, found %d" % (filename, count, len(values)))
+  return sizes, values
+
+def writeText(filename, sizes, values):
+  fd = open(filename, "w")
+  fd.write("SIZE" + "".join(map(lambda s: " %d" % s, sizes)) + "\n")
+  if sizes:
+    row = sizes[0]
+    for i in xrange(0, len(values), max(row, 1)):
+      fd.write("".join(map(lambda v: "%4.8g " % v, values[i:i+row])) + "\n")
+  else:
+    fd.write("%4.8g\n" % values[0])
+  fd.close()
+
+def readBinary(filename):
+  fd = open(filename, "rb")
+  raw = fd.read(struct.calcsize(HEADER_FORMAT))
+  magic, version, byteOrder, elementType, elementSize, dims, reserved, dataOffset = \
+      struct.unpack(HEADER_FORMAT, raw)[:8]
+  prefix = "="
+  if byteOrder != BYTEORDER:
+    prefix = {"<": ">", ">": "<"}[sys.byteorder == "little" and "<" or ">"]
+  header = struct.unpack(prefix + HEADER_FORMAT[1:], raw)
+  magic, version, byteOrder, elementType, elementSize, dims, reserved, dataOffset = header[:8]
+  if magic != MAGIC or version != FORMAT_VERSION or elementType != TYPE_FLOAT:
+    raise Exception("%s: not a supported binary matrix" % filename)
+  sizes = list(header[8:8+dims])
+  count = reduce(lambda x, y: x*y, sizes, 1)
+  fd.seek(dataOffset)
+  code = {4: "f", 8: "d"}[elementSize]
+  values = struct.unpack(prefix + code*count, fd.read(elementSize*count))
+  fd.close()
+  return sizes, values
+
+def writeBinary(filename, sizes, values):
+  padded = sizes + [0]*(MAX_DIMENSIONS-len(sizes))
+  header = struct.pack(HEADER_FORMAT, MAGIC, FORMAT_VERSION, BYTEORDER, TYPE_FLOAT, 8,
+                       len(sizes), 0, ALIGNMENT, *padded)
+  fd = open(filename, "wb")
+  fd.write(header)
+  fd.write("\0"*(ALIGNMENT-len(header)))
+  array.array("d", values).tofile(fd)
+  fd.close()
+
+def isBinary(filename):
+  fd = open(filename, "rb")
+  binary = fd.read(1) == MAGIC[0]
+  fd.close()
+  return binary
+
+def main(args):
+  if len(args) != 2:
+    print __doc__
+    sys.exit(1)
+  src, dst = args
+  if isBinary(src):
+    sizes, values = readBinary(src)
+  else:
+    sizes, values = readText(src)
+  if dst.endswith(".pbmat"):
+    writeBinary(dst, sizes, values)
+  else:
+    writeText(dst, sizes, values)
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
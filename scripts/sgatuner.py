@@ -644,6 +644,8 @@ be added to that list"""
       if pop.best and config.output_cfg:
         print pop.best.cfgfile(),"=>" , config.output_cfg
         shutil.copyfile(pop.best.cfgfile(), config.output_cfg)
+        #largest input size trained on, read by choiceprofile.py
+        open(config.output_cfg+".trained", "w").write("max_input_size = %d\n" % pop.inputSize())
       if pop.best and returnBest is not None:
         returnBest.append(pop.best)
       at = storagedirs.getactivetimers()
@@ -96,8 +96,8 @@ class config_defaults:
   recompile = True
 
   #types of mutatators to generate
-  lognorm_tunable_types       = ['system.cutoff.splitsize', 'system.cutoff.sequential', 'system.cutoff.distributed', 'system.size.blocksize']
-  uniform_tunable_types       = ['system.flag.localmem', 'system.gpuratio']
+  lognorm_tunable_types       = ['system.cutoff.splitsize', 'system.cutoff.sequential', 'system.cutoff.distributed', 'system.size.blocksize', 'system.size.tile']
+  uniform_tunable_types       = ['system.flag.localmem', 'system.gpuratio', 'system.size.blocknumber', 'system.flag.bisect', 'system.size.unroll']
   autodetect_tunable_types    = ['user.tunable']
   lognorm_sizespecific_tunable_types = ['user.tunable.accuracy.array', 'system.tunable.accuracy.array', 'user.tunable.array']
   optimize_tunable_types      = ['user.tunable.double', 'user.tunable.double.array']
@@ -0,0 +1,66 @@
+#!/usr/bin/env python
+
+"""Compare pbc output with and without --vectorize on element-wise benchmarks.
+
+Usage: vectorbench.py [benchmark ...]
+
+"""
+
+import os
+import subprocess
+import sys
+
+import pbutil
+
+TRIALS = 5
+
+BENCHMARKS = [
+  ("simple/add",                    1024),
+  ("simple/copy",                   1024),
+  ("simple/scale",                  1024),
+  ("convolution/Convolution",       8192),
+  ("convolution/convolutionSeparable", 1024),
+]
+
+MODES = ["vectorize", "novectorize"]
+
+def binaryName(benchmark, mode):
+  return pbutil.benchmarkToBin(benchmark)+"."+mode
+
+def compile(benchmark, mode):
+  src = pbutil.benchmarkToSrc(benchmark)
+  cmd = ["./src/pbc", "--"+mode, "--output="+binaryName(benchmark, mode), src]
+  NULL = open("/dev/null", "w")
+  rv = subprocess.call(cmd, stdout=NULL, stderr=NULL)
+  NULL.close()
+  if rv != 0:
+    raise Exception("compile failed: "+" ".join(cmd))
+
+def time(benchmark, mode, n):
+  return pbutil.executeTimingRun(binaryName(benchmark, mode), n,
+                                 ['--trials=%d' % TRIALS])['average']
+
+def main(args):
+  pbutil.chdirToPetabricksRoot()
+  pbutil.compilePetabricks()
+
+  benchmarks = BENCHMARKS
+  if args:
+    benchmarks = filter(lambda b: b[0] in args, BENCHMARKS)
+
+  print "%-36s %8s %12s %12s %8s" % ("benchmark", "n", "vectorize", "novectorize", "speedup")
+  for benchmark, n in benchmarks:
+    times = dict()
+    for mode in MODES:
+      compile(benchmark, mode)
+      times[mode] = time(benchmark, mode, n)
+    print "%-36s %8d %12.6f %12.6f %7.2fx" % (benchmark, n,
+                                              times["vectorize"],
+                                              times["novectorize"],
+                                              times["novectorize"]/times["vectorize"])
+    for mode in MODES:
+      os.unlink(binaryName(benchmark, mode))
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
+
@@ -0,0 +1,254 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "affineformula.h"
+
+#include <climits>
+
+namespace { //file local
+  //keep all intermediate values small enough that products fit in a long long
+  const long long theLimit = INT_MAX;
+
+  bool inRange(long long v){
+    return v <= theLimit && v >= -theLimit;
+  }
+
+  long long gcd(long long a, long long b){
+    if(a<0) a=-a;
+    if(b<0) b=-b;
+    while(b!=0){
+      long long t = a%b;
+      a = b;
+      b = t;
+    }
+    return a;
+  }
+
+  bool isReservedName(const std::string& name){
+    //maxima constants and special values are not free integer variables
+    return name.empty()
+        || name[0]=='%'
+        || name=="inf"
+        || name=="minf"
+        || name=="infinity"
+        || name=="und"
+        || name=="ind";
+  }
+
+  petabricks::FormulaPtr mkInteger(long long v){
+    return new petabricks::FormulaInteger(static_cast<int>(v));
+  }
+}
+
+petabricks::AffineRational::AffineRational(long long n, long long d)
+  : _num(n), _den(d)
+{
+  JASSERT(d!=0);
+  if(_den<0){
+    _num = -_num;
+    _den = -_den;
+  }
+  long long g = gcd(_num, _den);
+  if(g>1){
+    _num /= g;
+    _den /= g;
+  }
+}
+
+long long petabricks::AffineRational::floor() const {
+  if(_num>=0) return _num/_den;
+  return -((-_num + _den - 1)/_den);
+}
+
+long long petabricks::AffineRational::ceiling() const {
+  return -AffineRational(-_num, _den).floor();
+}
+
+bool petabricks::AffineRational::add(const AffineRational& a, const AffineRational& b, AffineRational& out){
+  long long g = gcd(a._den, b._den);
+  long long n = a._num*(b._den/g) + b._num*(a._den/g);
+  long long d = (a._den/g)*b._den;
+  if(!inRange(d)) return false;
+  AffineRational t(n, d);
+  if(!inRange(t._num)) return false;
+  out = t;
+  return true;
+}
+
+bool petabricks::AffineRational::mul(const AffineRational& a, const AffineRational& b, AffineRational& out){
+  //cross reduce first to keep the values small
+  long long g1 = gcd(a._num, b._den);
+  long long g2 = gcd(b._num, a._den);
+  if(g1==0) g1=1;
+  if(g2==0) g2=1;
+  long long n = (a._num/g1)*(b._num/g2);
+  long long d = (a._den/g2)*(b._den/g1);
+  if(!inRange(n) || !inRange(d)) return false;
+  out = AffineRational(n, d);
+  return true;
+}
+
+bool petabricks::AffineRational::div(const AffineRational& a, const AffineRational& b, AffineRational& out){
+  if(b.isZero()) return false;
+  return mul(a, AffineRational(b._den, b._num), out);
+}
+
+bool petabricks::AffineFormula::tryBuild(const FormulaPtr& f, AffineFormula& out){
+  const Formula* p = f.asPtr();
+  if(const FormulaInteger* i = dynamic_cast<const FormulaInteger*>(p)){
+    out = AffineFormula(AffineRational(static_cast<long long>(i->value())));
+    return true;
+  }
+  if(dynamic_cast<const FormulaVariable*>(p) != NULL){
+    std::string name = p->toString();
+    if(isReservedName(name)) return false;
+    out = AffineFormula();
+    out._coeffs[name] = AffineRational(1);
+    return true;
+  }
+  if(const FormulaAdd* op = dynamic_cast<const FormulaAdd*>(p)){
+    AffineFormula r;
+    return tryBuild(op->left(), out) && tryBuild(op->right(), r) && out.add(r, 1);
+  }
+  if(const FormulaSubtract* op = dynamic_cast<const FormulaSubtract*>(p)){
+    AffineFormula r;
+    return tryBuild(op->left(), out) && tryBuild(op->right(), r) && out.add(r, -1);
+  }
+  if(const FormulaMultiply* op = dynamic_cast<const FormulaMultiply*>(p)){
+    AffineFormula r;
+    if(!tryBuild(op->left(), out) || !tryBuild(op->right(), r)) return false;
+    if(r.isConstant()) return out.scale(r.constant());
+    if(out.isConstant()){
+      AffineRational c = out.constant();
+      out = r;
+      return out.scale(c);
+    }
+    return false; //non-linear
+  }
+  if(const FormulaDivide* op = dynamic_cast<const FormulaDivide*>(p)){
+    AffineFormula r;
+    if(!tryBuild(op->left(), out) || !tryBuild(op->right(), r)) return false;
+    if(!r.isConstant() || r.constant().isZero()) return false;
+    AffineRational inv;
+    return AffineRational::div(AffineRational(1), r.constant(), inv) && out.scale(inv);
+  }
+  return false;
+}
+
+bool petabricks::AffineFormula::add(const AffineFormula& that, int sign){
+  AffineRational s(sign);
+  AffineRational t;
+  if(!AffineRational::mul(that._constant, s, t)) return false;
+  if(!AffineRational::add(_constant, t, _constant)) return false;
+  for(CoeffMap::const_iterator i=that._coeffs.begin(); i!=that._coeffs.end(); ++i){
+    if(!AffineRational::mul(i->second, s, t)) return false;
+    AffineRational& c = _coeffs[i->first];
+    if(!AffineRational::add(c, t, c)) return false;
+    if(c.isZero()) _coeffs.erase(i->first);
+  }
+  return true;
+}
+
+bool petabricks::AffineFormula::scale(const AffineRational& factor){
+  if(factor.isZero()){
+    _coeffs.clear();
+    _constant = AffineRational();
+    return true;
+  }
+  if(!AffineRational::mul(_constant, factor, _constant)) return false;
+  for(CoeffMap::iterator i=_coeffs.begin(); i!=_coeffs.end(); ++i){
+    if(!AffineRational::mul(i->second, factor, i->second)) return false;
+  }
+  return true;
+}
+
+bool petabricks::AffineFormula::substitute(const std::string& var, const AffineFormula& with){
+  CoeffMap::iterator i = _coeffs.find(var);
+  if(i == _coeffs.end()) return true;
+  AffineFormula t = with;
+  AffineRational c = i->second;
+  _coeffs.erase(i);
+  return t.scale(c) && add(t, 1);
+}
+
+bool petabricks::AffineFormula::commonDenominator(long long& out) const {
+  out = _constant.den();
+  for(CoeffMap::const_iterator i=_coeffs.begin(); i!=_coeffs.end(); ++i){
+    out = (out / gcd(out, i->second.den())) * i->second.den();
+    if(!inRange(out)) return false;
+  }
+  return true;
+}
+
+petabricks::FormulaPtr petabricks::AffineFormula::toFormula() const {
+  long long denom;
+  if(!commonDenominator(denom)) return FormulaPtr();
+  AffineFormula scaled = *this;
+  if(!scaled.scale(AffineRational(denom))) return FormulaPtr();
+
+  FormulaPtr expr;
+  for(CoeffMap::const_iterator i=scaled._coeffs.begin(); i!=scaled._coeffs.end(); ++i){
+    JASSERT(i->second.isInteger());
+    long long k = i->second.num();
+    FormulaPtr term = new FormulaVariable(i->first);
+    if(k!=1 && k!=-1)
+      term = new FormulaMultiply(mkInteger(k<0 ? -k : k), term);
+    if(!expr)
+      expr = k<0 ? FormulaPtr(new FormulaSubtract(FormulaInteger::zero(), term)) : term;
+    else if(k<0)
+      expr = new FormulaSubtract(expr, term);
+    else
+      expr = new FormulaAdd(expr, term);
+  }
+
+  JASSERT(scaled._constant.isInteger());
+  long long c = scaled._constant.num();
+  if(!expr)
+    expr = mkInteger(c);
+  else if(c>0)
+    expr = new FormulaAdd(expr, mkInteger(c));
+  else if(c<0)
+    expr = new FormulaSubtract(expr, mkInteger(-c));
+
+  if(denom!=1)
+    expr = new FormulaDivide(expr, mkInteger(denom));
+  return expr;
+}
+
+petabricks::FormulaPtr petabricks::AffineFormula::toStaticCeilingFormula() const {
+  if(isConstant())
+    return mkInteger(_constant.ceiling());
+  long long denom;
+  if(!commonDenominator(denom)) return FormulaPtr();
+  if(denom==1)
+    return toFormula();
+  AffineFormula numerator = *this;
+  if(!numerator.scale(AffineRational(denom))) return FormulaPtr();
+  if(!numerator.add(AffineFormula(AffineRational(denom-1)), 1)) return FormulaPtr();
+  FormulaPtr n = numerator.toFormula();
+  if(!n) return FormulaPtr();
+  return new FormulaDivide(n, mkInteger(denom));
+}
@@ -0,0 +1,105 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PETABRICKSAFFINEFORMULA_H
+#define PETABRICKSAFFINEFORMULA_H
+
+#include "formula.h"
+
+#include <map>
+#include <string>
+
+namespace petabricks {
+
+/**
+ * A rational number with a normalized (positive, reduced) denominator
+ */
+class AffineRational {
+public:
+  AffineRational(long long n=0, long long d=1);
+
+  long long num() const { return _num; }
+  long long den() const { return _den; }
+
+  bool isZero()    const { return _num==0; }
+  bool isInteger() const { return _den==1; }
+  int  sign()      const { return _num<0 ? -1 : (_num>0 ? 1 : 0); }
+
+  long long floor() const;
+  long long ceiling() const;
+
+  /// Arithmetic helpers, return false on overflow
+  static bool add(const AffineRational& a, const AffineRational& b, AffineRational& out);
+  static bool mul(const AffineRational& a, const AffineRational& b, AffineRational& out);
+  static bool div(const AffineRational& a, const AffineRational& b, AffineRational& out);
+private:
+  long long _num;
+  long long _den;
+};
+
+/**
+ * In-process representation of an affine formula:
+ *   constant + c1*v1 + c2*v2 + ...
+ * with rational coefficients.  Used by MaximaWrapper to answer the common
+ * (linear) symbolic queries without a round trip to maxima.
+ */
+class AffineFormula {
+public:
+  typedef std::map<std::string, AffineRational> CoeffMap;
+
+  AffineFormula(const AffineRational& c = AffineRational()) : _constant(c) {}
+
+  ///
+  /// Convert a formula tree, returns false if it is not affine
+  static bool tryBuild(const FormulaPtr& f, AffineFormula& out);
+
+  ///
+  /// Convert back to a canonical formula tree
+  FormulaPtr toFormula() const;
+
+  ///
+  /// (num + den - 1)/den where num/den is the common denominator form
+  FormulaPtr toStaticCeilingFormula() const;
+
+  bool isConstant() const { return _coeffs.empty(); }
+  const AffineRational& constant() const { return _constant; }
+  const CoeffMap& coefficients() const { return _coeffs; }
+
+  /// Arithmetic helpers, return false on overflow or non-affine results
+  bool add(const AffineFormula& that, int sign=1);
+  bool scale(const AffineRational& factor);
+  bool substitute(const std::string& var, const AffineFormula& with);
+
+  /// Lowest common multiple of all denominators
+  bool commonDenominator(long long& out) const;
+private:
+  AffineRational _constant;
+  CoeffMap       _coeffs;
+};
+
+}
+
+#endif
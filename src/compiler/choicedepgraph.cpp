@@ -237,6 +237,20 @@ void petabricks::BasicChoiceDepGraphNode::generateCodeForSlice(Transform& trans,
   }
 }
 
+void petabricks::BasicChoiceDepGraphNode::generateCodeForBlock(Transform& trans, CodeGenerator& o, int d, const FormulaPtr& begin, const FormulaPtr& end, const RuleChoiceAssignment& choice){
+  JASSERT(choice.find(this)!=choice.end());
+  RulePtr rule = choice.find(this)->second;
+
+  CoordinateFormula min = _region->minCoord();
+  CoordinateFormula max = _region->maxCoord();
+
+  min[d] = begin;
+  max[d] = end;
+
+  SimpleRegionPtr t = new SimpleRegion(min,max);
+  rule->generateCallCode(nodename(), trans, o, t, RuleFlavor::SEQUENTIAL, _regionNodesGroups, id(), _gpuCopyOut);
+}
+
 void petabricks::BasicChoiceDepGraphNode::removeDimensionFromRegions(
                                                           MatrixDefPtr matrix, 
                                                           size_t dimension) {
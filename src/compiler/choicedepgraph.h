@@ -246,6 +246,11 @@ public:
                             const RuleChoiceAssignment& choice);
   void generateCodeForSlice(Transform& trans, CodeGenerator& o, int dimension, const FormulaPtr& pos, RuleFlavor flavor,
                             const RuleChoiceAssignment& choice, std::string lastTask);
+
+  ///
+  /// Generate sequential code for the part of this node in [begin, end) along dimension
+  void generateCodeForBlock(Transform& trans, CodeGenerator& o, int dimension, const FormulaPtr& begin, const FormulaPtr& end,
+                            const RuleChoiceAssignment& choice);
   void removeDimensionFromRegions(MatrixDefPtr matrix, size_t dimension);
   void fixVersionedRegionsType();
 
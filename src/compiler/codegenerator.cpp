@@ -72,13 +72,13 @@ petabricks::CodeGenerator::CodeGenerator(CodeGenerator& that)
 
 void petabricks::CodeGenerator::beginFor(const std::string& var, const FormulaPtr& begin, const FormulaPtr& end,  const FormulaPtr& step){
   indent();
-  os() << "for(int " << var << "=" << begin << "; "<< var << "<" << end << "; " << var << "+="<< step <<" ){\n";
+  os() << "for(IndexT " << var << "=" << begin << "; "<< var << "<" << end << "; " << var << "+="<< step <<" ){\n";
   _indent++;
 }
 
 void petabricks::CodeGenerator::beginReverseFor(const std::string& var, const FormulaPtr& begin, const FormulaPtr& end,  const FormulaPtr& step){
   indent();
-  os() << "for(int " << var << "=" << end->minusOne() << "; "<< var << ">=" << begin << "; " << var << "-="<< step <<" ){\n";
+  os() << "for(IndexT " << var << "=" << end->minusOne() << "; "<< var << ">=" << begin << "; " << var << "-="<< step <<" ){\n";
   _indent++;
 }
 
@@ -191,6 +191,22 @@ void petabricks::CodeGenerator::trace(const std::string& str){
   os() << "JTRACE(\"" << str << "\");\n";
 }
 
+void petabricks::CodeGenerator::perfScope(const std::string& site, const std::string& kind, const std::string& cells, bool isTask){
+  write("static petabricks::PerfSite _perfsite(\""+site+"\", petabricks::PerfSite::"+kind+");");
+  write("petabricks::PerfScope _perfscope(_perfsite, "+cells+", "+(isTask ? "true" : "false")+");");
+}
+
+void petabricks::CodeGenerator::beginPerfScope(const std::string& site, const std::string& kind, const std::string& cells, bool isTask){
+  write("{");
+  incIndent();
+  perfScope(site, kind, cells, isTask);
+}
+
+void petabricks::CodeGenerator::endPerfScope(){
+  decIndent();
+  write("}");
+}
+
 namespace{//file local
   void _splitTypeArgs(std::string& type, std::string& name, const std::string& str){
     const char* begin=str.c_str();
@@ -397,6 +413,21 @@ void petabricks::CodeGenerator::continuationRequired(const std::string& hookname
     beginUserCode(_rf);
 }
 
+///
+/// Back edge of an expanded loop: jump directly for a bounded number of
+/// iterations, then return to the scheduler so the stack does not grow with
+/// the trip count
+void petabricks::CodeGenerator::continueLoop(const std::string& fn){
+#ifndef DISABLE_CONTINUATIONS
+  std::string n = "_loopiters_" + fn;
+  addMember("int", n, "0");
+  beginIf("useContinuation() && ++"+n+" >= PB_LOOP_INLINE_ITERS");
+  write(n+" = 0;");
+  write("return new petabricks::MethodCallTask<"+_curClass+", &"+_curClass+"::"+fn+">( this );");
+  endIf();
+#endif
+  continueJump(fn);
+}
 
 petabricks::CodeGenerator& petabricks::CodeGenerator::forkhelper(){
   CodeGenerator* cg;
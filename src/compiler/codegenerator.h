@@ -144,6 +144,13 @@ public:
 
   void trace(const std::string& str);
 
+  ///
+  /// Record this point as a runtime PerfSite (for pbc --perfcounters), the
+  /// sample covers from here to the end of the enclosing block
+  void perfScope(const std::string& site, const std::string& kind, const std::string& cells, bool isTask);
+  void beginPerfScope(const std::string& site, const std::string& kind, const std::string& cells, bool isTask);
+  void endPerfScope();
+
   void createTunable( bool isTunable
                     , const std::string& category
                     , const std::string& name
@@ -219,6 +226,7 @@ public:
   void continueJump(const std::string& fn){
     write("return "+fn+"();");
   }
+  void continueLoop(const std::string& fn);
 
   void define(const std::string& name, const std::string& val){
     _defines.push_back(name);
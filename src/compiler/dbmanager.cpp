@@ -27,91 +27,97 @@
 
 #include "dbmanager.h"
 #include "common/jfilesystem.h"
+#include "common/jtimer.h"
 #include <fstream>
+#include <stdlib.h>
 
 namespace {
-  /** Multiprocess-safe Wrapper of sqlite3_exec: if a query fails because 
-   * a table is blocked by another process, it is tried again for some times */
-  static int db_exec(sqlite3* db, const char *query, int (*callback)(void*,int,char**,char**), void * argument, char **errmsg) {
-    int retCode;
-    int retry = 500; //Number of trials before aborting
-    
-    retCode = sqlite3_exec(db, query, callback, argument, errmsg);
-    retry--;
-    
-    while ((retCode == SQLITE_LOCKED || retCode == SQLITE_BUSY) && --retry) {
-      retCode = sqlite3_exec(db, query, callback, argument, errmsg);
-      usleep(200*1000);
-    }
-    
-    return retCode;
-  }
-  
-  static int getHeuristic(void* result, int, char** colText, char**) {
-    char* formula=colText[0];
-    petabricks::Heuristic* newHeuristic = new petabricks::Heuristic(formula);
-    
-    *((petabricks::HeuristicPtr *)result) = newHeuristic;
-    return 0;
+  struct LogTotals {
+    double score;
+    long useCount;
+    LogTotals() : score(0), useCount(0) {}
+  };
+  typedef std::map<std::string, LogTotals> FormulaTotals;
+  typedef std::map<std::string, FormulaTotals> HeuristicTotals;
+
+  /** Parse "name \t useCountDelta \t scoreDelta \t formula", false if the
+   * line is malformed (e.g. the tail of a writer that was killed) */
+  static bool parseLogLine(const std::string& line, std::string& name, long& uses, double& score, std::string& formula) {
+    size_t a = line.find('\t');
+    if(a == std::string::npos) return false;
+    size_t b = line.find('\t', a+1);
+    if(b == std::string::npos) return false;
+    size_t c = line.find('\t', b+1);
+    if(c == std::string::npos || c+1 >= line.length()) return false;
+    name = line.substr(0, a);
+    uses = atol(line.substr(a+1, b-a-1).c_str());
+    score = atof(line.substr(b+1, c-b-1).c_str());
+    formula = line.substr(c+1);
+    return true;
   }
 }
 
-petabricks::DBManager::DBManager(std::string dbFileName) : emptyDB(false) {
-  int retCode;
-
+petabricks::DBManager::DBManager(std::string dbFileName) : _loadTime(0) {
   if(dbFileName=="") {
     dbFileName=defaultDBFileName();
   }
-  
-  //Check if DB exists
+
   if(! jalib::Filesystem::FileExists(dbFileName)) {
-    emptyDB = true;
+    return;
   }
-    
-  //Open DB
-  retCode = sqlite3_open(dbFileName.c_str(), &_db);
 
-  if(retCode && emptyDB) {
-    retCode = sqlite3_open(":memory:", &_db);
+  jalib::JTime start = jalib::JTime::now();
+  HeuristicTotals totals;
+  std::ifstream log(dbFileName.c_str());
+  std::string line, name, formula;
+  long uses;
+  double score;
+  while(std::getline(log, line)) {
+    if(log.eof()) {
+      //no trailing newline, the write that produced it was cut short
+      break;
+    }
+    if(!parseLogLine(line, name, uses, score, formula)) {
+      JWARNING(false)(dbFileName)(line).Text("skipping malformed heuristic log line");
+      continue;
+    }
+    LogTotals& t = totals[name][formula];
+    t.useCount += uses;
+    t.score += score;
   }
 
-  if(retCode) {
-    std::cerr << "Can't open DB: " << dbFileName << "\n";
-    sqlite3_close(_db);
-    abort();
+  //same order as the learning compiler: highest score per use first
+  for(HeuristicTotals::const_iterator h=totals.begin(); h!=totals.end(); ++h) {
+    const std::string* best = NULL;
+    double bestRate = 0;
+    for(FormulaTotals::const_iterator f=h->second.begin(); f!=h->second.end(); ++f) {
+      if(f->second.useCount <= 0) continue;
+      double rate = f->second.score / f->second.useCount;
+      if(best == NULL || rate > bestRate) {
+        best = &f->first;
+        bestRate = rate;
+      }
+    }
+    if(best != NULL) {
+      _best[h->first] = *best;
+    }
   }
+  _loadTime = jalib::JTime::now() - start;
+  JTRACE("loaded heuristics")(dbFileName)(_best.size())(_loadTime);
 }
 
 
 std::string petabricks::DBManager::defaultDBFileName() {
   char* homeDir = getenv("HOME");
-  return std::string(homeDir) + "/tunerout/knowledge.db";
+  return std::string(homeDir) + "/tunerout/knowledge.log";
 }
 
 
 petabricks::HeuristicPtr petabricks::DBManager::getBestHeuristic(std::string name) {
-  int retCode;
-  char *zErrMsg = 0;
   HeuristicPtr result;
-  
-  if(emptyDB) {
-    //Return empty result
-    return result;
-  }
-  
-  std::string query = "SELECT formula FROM Heuristic JOIN HeuristicKind "
-                      "ON Heuristic.kindID=HeuristicKind.ID "
-                      "WHERE HeuristicKind.name='"+ name + "' "
-                      "ORDER BY Heuristic.score/Heuristic.useCount DESC "
-                      "LIMIT 1";
-                      
-  retCode = db_exec(_db, query.c_str(), getHeuristic, &result, &zErrMsg);
-  if (retCode) {
-    std::cerr << "Error getting the required heuristic: (" << retCode << ") " << zErrMsg << "\n";
-    sqlite3_free(zErrMsg);
-    sqlite3_close(_db);
-    //abort();
+  FormulaTable::const_iterator i = _best.find(name);
+  if(i != _best.end()) {
+    result = new Heuristic(i->second);
   }
-  
   return result;
 }
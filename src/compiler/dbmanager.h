@@ -27,30 +27,43 @@
 #ifndef DBMANAGER_H
 #define DBMANAGER_H
 
-#include <sqlite3.h>
 #include "heuristic.h"
 
+#include <map>
+#include <string>
+
 namespace petabricks {
 
+/**
+ * Read-only view of the heuristics learned by learningcompiler.py.
+ *
+ * The learning compiler appends one line per score or use count update to
+ * knowledge.log, each with a single O_APPEND write, so parallel writers
+ * never need a lock. The log is folded once, when pbc starts, into an
+ * immutable table holding the best formula for each heuristic name.
+ */
 class DBManager {
 public:
   DBManager(std::string dbFileName="");
-  
-  ~DBManager() {
-    sqlite3_close(_db);
-  }
-  
-  ///Get the path of the default DB file
+
+  ///Get the path of the default log file
   std::string defaultDBFileName();
-  
+
   ///Get the best heuristic with the given name
   HeuristicPtr getBestHeuristic(std::string name);
-  
+
+  ///Number of heuristic names with a learned formula
+  size_t size() const { return _best.size(); }
+
+  ///Seconds spent reading the log
+  double loadTime() const { return _loadTime; }
+
 private:
-  sqlite3 *_db;
-  bool emptyDB;
+  typedef std::map<std::string, std::string> FormulaTable;
+  FormulaTable _best;
+  double _loadTime;
 };
-  
+
 }
 
-#endif
\ No newline at end of file
+#endif
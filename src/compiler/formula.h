@@ -265,6 +265,9 @@ public:
 
   virtual char opType() const;
 
+  const FormulaPtr& left()  const { return _left; }
+  const FormulaPtr& right() const { return _right; }
+
   virtual FormulaPtr clone() const {
     FormulaPtr newLeft = _left->clone();
     FormulaPtr newRight= _right->clone();
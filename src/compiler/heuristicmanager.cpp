@@ -27,7 +27,17 @@
 #include "heuristicmanager.h"
 #include "tinyxml.h"
 
+#include "common/jtimer.h"
+
 petabricks::HeuristicPtr& petabricks::HeuristicManager::getHeuristic(const std::string name) {
+  jalib::JTime start = jalib::JTime::now();
+  HeuristicPtr& h = findHeuristic(name);
+  _lookupTime += jalib::JTime::now() - start;
+  ++_lookups;
+  return h;
+}
+
+petabricks::HeuristicPtr& petabricks::HeuristicManager::findHeuristic(const std::string& name) {
   //From cache
   HeuristicMap::iterator found=_heuristicCache.find(name);
   if (found != _heuristicCache.end()) {
@@ -54,12 +54,25 @@ public:
   HeuristicPtr& getHeuristic(const std::string name);
   
   const HeuristicMap& usedHeuristics() const { return _heuristicCache; }
+
+  ///Number of getHeuristic() calls and the seconds spent in them
+  int lookups() const { return _lookups; }
+  double lookupTime() const { return _lookupTime; }
+
+  ///Seconds spent loading the learned heuristics at startup
+  double loadTime() const { return _db.loadTime(); }
   
 private:
+  HeuristicManager() : _lookups(0), _lookupTime(0) {}
+
+  HeuristicPtr& findHeuristic(const std::string& name);
+
   HeuristicMap _heuristicCache;
   HeuristicMap _defaultHeuristics;
   HeuristicMap _fromFile;
   DBManager _db;
+  int _lookups;
+  double _lookupTime;
 };
 
 }
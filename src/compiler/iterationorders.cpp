@@ -125,12 +125,15 @@ void petabricks::IterationDefinition::genLoopBegin(CodeGenerator& o){
     }
   }else{
     o.comment("Iterate along all the directions");
-    for(size_t i=0; i<_var.size(); ++i){
+    std::vector<int> nest = loopOrder();
+    for(size_t n=0; n<nest.size(); ++n){
+      int i = nest[n];
       FormulaPtr b=_begin[i];
       FormulaPtr e=_end[i];
       FormulaPtr s=_step[i];
       FormulaPtr v=_var[i];
-      //TODO: expand to reorder dimensions
+      if(n+1==nest.size() && isInnerLoopIndependent())
+        o.write("VECTORIZE_LOOP");
       if(_order.canIterateForward(i) || !_order.canIterateBackward(i)){
         JWARNING(_order.canIterateForward(i))(_order).Text("couldn't find valid iteration order, assuming forward");
         o.beginFor(v->toString(), b, e, s);
@@ -151,6 +154,138 @@ void petabricks::IterationDefinition::genLoopEnd(CodeGenerator& o){
   }
 }
 
+bool petabricks::IterationDefinition::canUnrollInner() const {
+  if(isSingleCall() || dimensions()<1)
+    return false;
+  return _step[loopOrder().back()]->toString() == "1";
+}
+
+std::string petabricks::IterationDefinition::innerExtent() const {
+  int i = loopOrder().back();
+  return "("+_end[i]->toString()+"-"+_begin[i]->toString()+")";
+}
+
+void petabricks::IterationDefinition::genOuterLoopBegin(CodeGenerator& o){
+  JASSERT(canUnrollInner());
+  std::vector<int> nest = loopOrder();
+  for(size_t n=0; n+1<nest.size(); ++n){
+    int i = nest[n];
+    if(_order.canIterateForward(i) || !_order.canIterateBackward(i)){
+      o.beginFor(_var[i]->toString(), _begin[i], _end[i], _step[i]);
+    } else {
+      o.beginReverseFor(_var[i]->toString(), _begin[i], _end[i], _step[i]);
+    }
+  }
+}
+
+void petabricks::IterationDefinition::genOuterLoopEnd(CodeGenerator& o){
+  for(size_t i=0; i+1<_var.size(); ++i){
+    o.endFor();
+  }
+}
+
+void petabricks::IterationDefinition::genUnrolledIter(CodeGenerator& o, int iter){
+  int i = loopOrder().back();
+  std::string k = jalib::XToString(iter);
+  if(_order.canIterateForward(i) || !_order.canIterateBackward(i)){
+    o.varDecl("const IndexT "+_var[i]->toString()+" = "+_begin[i]->toString()+"+"+k);
+  }else{
+    o.varDecl("const IndexT "+_var[i]->toString()+" = "+_end[i]->toString()+"-1-"+k);
+  }
+}
+
+bool petabricks::IterationDefinition::canReorder() const {
+  if(isSingleCall() || _order.isMultioutput())
+    return false;
+  //each dimension must have a single legal direction, then every dependency
+  //vector is non-negative in the iteration order and loops can be permuted
+  for(int i=0; i<dimensions(); ++i){
+    if(!_order.canIterateForward(i) && !_order.canIterateBackward(i))
+      return false;
+  }
+  return true;
+}
+
+bool petabricks::IterationDefinition::canTile() const {
+  return dimensions()>=2 && canReorder();
+}
+
+std::vector<int> petabricks::IterationDefinition::loopOrder() const {
+  std::vector<int> rv;
+  for(int i=0; i<dimensions(); ++i)
+    rv.push_back(i);
+#ifndef COLUMN_MAJOR
+  //dimension 0 is stored contiguously, so iterate it innermost
+  if(pbcConfig::theVectorize && canReorder())
+    std::reverse(rv.begin(), rv.end());
+#endif
+  return rv;
+}
+
+bool petabricks::IterationDefinition::isInnerLoopIndependent() const {
+  if(!pbcConfig::theVectorize || isSingleCall() || dimensions()<1 || _order.isMultioutput())
+    return false;
+  return (_order[loopOrder().back()] & DependencyDirection::D_NEQ) == 0;
+}
+
+bool petabricks::IterationDefinition::canBisect() const {
+  if(isSingleCall() || dimensions()<2 || _order.isMultioutput())
+    return false;
+  for(int i=0; i<dimensions(); ++i){
+    if((_order[i] & DependencyDirection::D_NEQ) != 0)
+      return false;
+  }
+  return true;
+}
+
+bool petabricks::IterationDefinition::canWavefront() const {
+  if(dimensions()<2 || !canReorder())
+    return false;
+  for(int i=0; i<dimensions(); ++i){
+    if((_order[i] & DependencyDirection::D_NEQ) != 0)
+      return true;
+  }
+  return false;
+}
+
+void petabricks::IterationDefinition::genTiledLoopBegin(CodeGenerator& o, const std::string& tileSize){
+  JASSERT(canTile())(_order);
+  o.comment("Iterate along all the directions in tiles of "+tileSize+" iterations");
+  std::vector<int> nest = loopOrder();
+  for(size_t n=0; n<nest.size(); ++n){
+    int i = nest[n];
+    std::string v = _var[i]->toString();
+    std::string t = v+"_tile";
+    std::string span = "("+tileSize+")*("+_step[i]->toString()+")";
+    if(_order.canIterateForward(i)){
+      o.write("for(IndexT "+t+"="+_begin[i]->toString()+"; "+t+"<"+_end[i]->toString()+"; "+t+"+="+span+"){");
+    }else{
+      o.write("for(IndexT "+t+"="+_end[i]->minusOne()->toString()+"; "+t+">="+_begin[i]->toString()+"; "+t+"-="+span+"){");
+    }
+    o.incIndent();
+  }
+  for(size_t n=0; n<nest.size(); ++n){
+    int i = nest[n];
+    std::string v = _var[i]->toString();
+    std::string t = v+"_tile";
+    std::string span = "("+tileSize+")*("+_step[i]->toString()+")";
+    if(n+1==nest.size() && isInnerLoopIndependent())
+      o.write("VECTORIZE_LOOP");
+    if(_order.canIterateForward(i)){
+      o.write("for(IndexT "+v+"="+t+"; "+v+"<std::min<IndexT>("+_end[i]->toString()+", "+t+"+"+span+"); "+v+"+="+_step[i]->toString()+"){");
+    }else{
+      o.write("for(IndexT "+v+"="+t+"; "+v+">std::max<IndexT>("+_begin[i]->minusOne()->toString()+", "+t+"-"+span+"); "+v+"-="+_step[i]->toString()+"){");
+    }
+    o.incIndent();
+  }
+}
+
+void petabricks::IterationDefinition::genTiledLoopEnd(CodeGenerator& o){
+  for(size_t i=0; i<2*_var.size(); ++i){
+    o.endFor();
+  }
+}
+
 void petabricks::IterationDefinition::genScratchRegionLoopBegin(CodeGenerator& o){
   if(isSingleCall()){
     genLoopBegin(o);
@@ -159,7 +294,7 @@ void petabricks::IterationDefinition::genScratchRegionLoopBegin(CodeGenerator& o
 
     // Compute size
     for(size_t i=0; i<_size.size(); ++i){
-      o.write("int " + _size[i]->toString() + " = " + _end[i]->toString() +
+      o.write("IndexT " + _size[i]->toString() + " = " + _end[i]->toString() +
               " - " + _begin[i]->toString() + ";");
     }
 
@@ -270,6 +405,56 @@ void petabricks::IterationDefinition::genSplitCode(CodeGenerator& o, Transform&
   }
 }
 
+void petabricks::IterationDefinition::genBisectCode(CodeGenerator& o, Transform& trans, RuleInterface& rule, RuleFlavor rf, SpatialCallType spatialCallType) const {
+  JASSERT(canBisect())(_order);
+  o.write("const int _bisect_d = petabricks::longest_dimension<"+jalib::XToString(dimensions())+">("COORD_BEGIN_STR", "COORD_END_STR");");
+
+  //the halves share every dimension but _bisect_d, which is cut at its middle
+  SimpleRegionPtr lower = new SimpleRegion();
+  SimpleRegionPtr upper = new SimpleRegion();
+  for(int i=0; i<dimensions(); ++i){
+    std::string d = jalib::XToString(i);
+    std::string b = _begin[i]->toString();
+    std::string e = _end[i]->toString();
+    o.write("const IndexT _bisect_hi"+d+" = _bisect_d=="+d+" ? "+b+"+("+e+"-"+b+")/2 : "+e+";");
+    o.write("const IndexT _bisect_lo"+d+" = _bisect_d=="+d+" ? _bisect_hi"+d+" : "+b+";");
+    lower->minCoord().push_back(_begin[i]);
+    lower->maxCoord().push_back(new FormulaVariable("_bisect_hi"+d));
+    upper->minCoord().push_back(new FormulaVariable("_bisect_lo"+d));
+    upper->maxCoord().push_back(_end[i]);
+  }
+
+  if(rf != RuleFlavor::SEQUENTIAL) {
+    o.write("GroupedDynamicTask<2>* _split_task = new GroupedDynamicTask<2>();");
+  }
+  rule.generateCallCode("(*_split_task)[0]", trans, o, lower, rf, spatialCallType);
+  rule.generateCallCode("(*_split_task)[1]", trans, o, upper, rf, spatialCallType);
+
+  if(rf!=RuleFlavor::SEQUENTIAL){
+    o.write("return petabricks::run_task(_split_task);");
+  }else{
+    o.write("return NULL;");
+  }
+}
+
+void petabricks::IterationDefinition::genWavefrontCode(CodeGenerator& o, const std::string& methodname, const std::string& tileSize) const {
+  JASSERT(canWavefront())(_order);
+  std::string dirs;
+  for(int i=0; i<dimensions(); ++i){
+    if(i>0)
+      dirs += ", ";
+    if((_order[i] & DependencyDirection::D_NEQ) == 0)
+      dirs += "0";
+    else if(_order.canIterateForward(i))
+      dirs += "1";
+    else
+      dirs += "-1";
+  }
+  o.write("const int _wavefront_dir[] = {"+dirs+"};");
+  o.write("return petabricks::spawn_wavefront<CLASS, "+jalib::XToString(dimensions())+", &CLASS::"+methodname+">"
+          "(this, "COORD_BEGIN_STR", "COORD_END_STR", "+tileSize+", _wavefront_dir);");
+}
+
 void petabricks::IterationDefinition::fillSplitRegionList(SplitRegionList& regions, SplitRegion& r, unsigned int blockNumber) const {
   int d = r.dimensions();
   if(d<dimensions()) {
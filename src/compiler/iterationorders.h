@@ -53,6 +53,55 @@ public:
   void genLoopBegin(CodeGenerator& o);
   void genLoopEnd(CodeGenerator& o);
 
+  ///
+  /// Loop nest blocked into tiles of tileSize iterations in each dimension,
+  /// only valid if canTile()
+  void genTiledLoopBegin(CodeGenerator& o, const std::string& tileSize);
+  void genTiledLoopEnd(CodeGenerator& o);
+
+  ///
+  /// True if a rectangular tiling of the iteration space preserves the
+  /// self dependencies given by order()
+  bool canTile() const;
+
+  ///
+  /// True if every dimension has a legal direction, so loops may be interchanged
+  bool canReorder() const;
+
+  ///
+  /// Dimensions in the order loops are nested, outermost first
+  std::vector<int> loopOrder() const;
+
+  ///
+  /// True if the innermost loop carries no self dependency and may be vectorized
+  bool isInnerLoopIndependent() const;
+
+  ///
+  /// True if no iteration depends on another, so any two halves of the
+  /// iteration space may run in parallel and genBisectCode() is legal
+  bool canBisect() const;
+
+  ///
+  /// True if the iteration space carries self dependencies but still has a
+  /// legal direction in every dimension, so genWavefrontCode() is legal
+  bool canWavefront() const;
+
+  ///
+  /// True if the innermost loop has a unit step, so it may be replaced by
+  /// straight line code for small extents
+  bool canUnrollInner() const;
+
+  ///
+  /// Number of iterations of the innermost loop
+  std::string innerExtent() const;
+
+  ///
+  /// Loop nest without its innermost loop, genUnrolledIter() then defines
+  /// the innermost variable for each iteration written out
+  void genOuterLoopBegin(CodeGenerator& o);
+  void genOuterLoopEnd(CodeGenerator& o);
+  void genUnrolledIter(CodeGenerator& o, int iter);
+
   void genScratchRegionLoopBegin(CodeGenerator& o);
   void genScratchRegionLoopEnd(CodeGenerator& o);
 
@@ -81,6 +130,18 @@ public:
 
   void genSplitCode(CodeGenerator& o, Transform& trans, RuleInterface& rule, RuleFlavor rf, unsigned int blockNumber, SpatialCallType spatialCallType) const;
 
+  ///
+  /// Cache oblivious alternative to genSplitCode(), cuts the longest
+  /// dimension in half and recurses through the rule's split condition, so
+  /// leaves are visited in Z-order
+  void genBisectCode(CodeGenerator& o, Transform& trans, RuleInterface& rule, RuleFlavor rf, SpatialCallType spatialCallType) const;
+
+  ///
+  /// Split for self dependent rules, one task per tile of tileSize
+  /// iterations, each depending on its predecessor tiles so tiles on the
+  /// same diagonal hyperplane run in parallel
+  void genWavefrontCode(CodeGenerator& o, const std::string& methodname, const std::string& tileSize) const;
+
 protected:
   void fillSplitRegionList(SplitRegionList& regions, SplitRegion& seed, unsigned int blockNumber) const;
   bool canDependOn(const SplitRegion& a, const SplitRegion& b) const;
@@ -41,7 +41,20 @@ petabricks::MatrixDef::MatrixDef(const char* name, const FormulaList& version, c
   : _name(name), _version(version), _size(size), _type(T_UNKNOWN)
 {}
 
+void petabricks::MatrixDef::setElementType(const char* name){
+  std::string t = name;
+  if(t=="float")       _elementType = "float";
+  else if(t=="double") _elementType = "double";
+  else if(t=="int32")  _elementType = "int32_t";
+  else if(t=="int64")  _elementType = "int64_t";
+  else JASSERT(false)(t)(_name).Text("unknown matrix element type, expected float, double, int32 or int64");
+  if(_elementType == STRINGIFY(MATRIX_ELEMENT_T))
+    _elementType.clear();
+}
+
 void petabricks::MatrixDef::print(std::ostream& o) const {
+  if(!hasDefaultElementType())
+    o << _elementType << ' ';
   o << _name;
   if(!_version.empty()){
     o << '<';
@@ -57,6 +70,10 @@ void petabricks::MatrixDef::print(std::ostream& o) const {
 
 void petabricks::MatrixDef::initialize(Transform& ){
   SRCPOSSCOPE();
+#ifndef DISABLE_DISTRIBUTED
+  JASSERT(hasDefaultElementType())(_name)(_elementType)
+    .Text("distributed code only supports the default element type");
+#endif
 //   _version.normalize();
 //   _size.normalize();
   if(_version.size()>0){
@@ -211,6 +228,8 @@ void petabricks::MatrixDef::readFromFileCode(CodeGenerator& o, const std::string
 
     // o.write("petabricks::MatrixIOGeneral().write("+name()+");");
 
+  } else if(!hasDefaultElementType()) {
+    o.varDecl(name()+" = petabricks::MatrixIOGeneral("+fn+",\"r\").read_typed<"+jalib::XToString(numDimensions())+", "+_elementType+">()");
   } else {
     o.varDecl(name()+" = petabricks::MatrixIOGeneral("+fn+",\"r\").read_"+rf.str()+"<"+jalib::XToString(numDimensions())+">()");
   }
@@ -123,6 +123,10 @@ public:
 // }
 
   std::string typeName(RuleFlavor rf, bool isConst=false, int slices = 0) const{
+    if(!hasDefaultElementType()){
+      return "petabricks::MatrixRegion<"+jalib::XToString(numDimensions()-slices)+", "
+             +(isConst ? "const " : "")+_elementType+">";
+    }
     std::string constness = isConst ? "Const" : "";
     return rf.string()+"::"+constness+genericTypeName(slices);
   }
@@ -147,6 +151,21 @@ public:
   void verifyDefines(CodeGenerator& o);
   void allocateTemporary(CodeGenerator& o, RuleFlavor rf, bool setOnly, bool reallocAllowed);
 
+  ///
+  /// Set the element type from its name in the source (float, double,
+  /// int32 or int64), by default matrices hold MATRIX_ELEMENT_T
+  void setElementType(const char* name);
+
+  ///
+  /// True if this matrix holds MATRIX_ELEMENT_T
+  bool hasDefaultElementType() const { return _elementType.empty(); }
+
+  ///
+  /// C++ type of a single element, as used in generated code
+  std::string elementTypeName() const {
+    return hasDefaultElementType() ? "ElementT" : _elementType;
+  }
+
   void addType(Type t){  _type |= t; }
   bool isAllInput() const { return _type == T_FROM; }
 
@@ -159,6 +178,7 @@ public:
 
 private:
   std::string _name;
+  std::string _elementType;
   FormulaList _version;
   FormulaList _size;
   int _type;
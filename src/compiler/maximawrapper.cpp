@@ -26,11 +26,15 @@
  *****************************************************************************/
 #include "maximawrapper.h"
 
+#include "pbc.h"
+
 #include "common/jassert.h"
 #include "common/jsocket.h"
 
+#include <fstream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -105,18 +109,55 @@ static const char * const theInitCode =
   "1"
 ;
 
+static const char * const theTranscriptHeader = "pbc-maxima-cache 1";
+
 extern FILE* maximain;
 extern petabricks::FormulaListPtr readFormulaFromMaxima();
 
+//the maxima lexer reads through here when the transcript is in use
+int maximaread(char* buf){
+  return petabricks::MaximaWrapper::instance().readChar(buf);
+}
+
+//extend a running FNV-1a hash with one command
+static uint64_t hashCommand(uint64_t h, const char* cmd, int len){
+  for(int i=0; i<len; ++i){
+    h ^= (unsigned char)cmd[i];
+    h *= 1099511628211ULL;
+  }
+  h ^= ';';
+  return h * 1099511628211ULL;
+}
+
 petabricks::MaximaWrapper& petabricks::MaximaWrapper::instance(){
   static MaximaWrapper inst;
   return inst;
 }
 
+bool& petabricks::MaximaWrapper::useNativeSimplifier(){
+  static bool v = true;
+  return v;
+}
+
 petabricks::MaximaWrapper::MaximaWrapper()
   : _fd(-1)
+  , _nativeHits(0)
+  , _nativeMisses(0)
   , _stackDepth(0)
+  , _deferredAtContext(0)
+  , _syncedInContext(false)
+  , _baseKey(hashCommand(14695981039346656037ULL, theInitCode, strlen(theInitCode)))
+  , _contextKey(0)
+  , _transcriptHits(0)
+  , _transcriptMisses(0)
+  , _replay(NULL)
+  , _replayPos(0)
+  , _record(NULL)
 {
+  //with --incremental maxima is started lazily by sync(), so a fully
+  //cached run never needs it
+  if(pbcConfig::theIncremental)
+    return;
 #ifdef MAXIMA_LOG
   _fd = forkopen(&launchMaximaWithLogging);
 #else
@@ -135,19 +176,136 @@ petabricks::MaximaWrapper::MaximaWrapper()
 
 petabricks::MaximaWrapper::~MaximaWrapper()
 {
+  JTRACE("native simplifier")(_nativeHits)(_nativeMisses);
+  JTRACE("maxima transcript")(_transcriptHits)(_transcriptMisses);
   maximain=NULL;
-  close(_fd);
+  if(_fd>=0)
+    close(_fd);
 }
 
 petabricks::FormulaListPtr petabricks::MaximaWrapper::runCommandRaw(const char* cmd, int len){
+  if(!pbcConfig::theIncremental){
+    static const char endCommand[] = ";\n";
+    JASSERT(write(_fd, cmd, len)==len)(cmd)(JASSERT_ERRNO);
+    JASSERT(write(_fd, endCommand, sizeof endCommand-1)==sizeof endCommand-1)(cmd)(JASSERT_ERRNO);
+    fsync(_fd);
+    return readFormulaFromMaxima();
+  }
+
+  uint64_t& key = _stackDepth>0 ? _contextKey : _baseKey;
+  key = hashCommand(key, cmd, len);
+
+  TranscriptT::const_iterator i = _transcript.find(key);
+  if(i != _transcript.end()) {
+    ++_transcriptHits;
+    _deferred.push_back(std::string(cmd, len));
+    _transcriptUsed[key] = i->second;
+    _replay = &i->second;
+    _replayPos = 0;
+    petabricks::FormulaListPtr result = readFormulaFromMaxima();
+    _replay = NULL;
+    return result;
+  }
+
+  ++_transcriptMisses;
+  sync();
+  std::string raw;
+  petabricks::FormulaListPtr result = send(std::string(cmd, len), &raw);
+  if(!_transcriptFile.empty())
+    _transcriptUsed[key] = raw;
+  return result;
+}
+
+petabricks::FormulaListPtr petabricks::MaximaWrapper::send(const std::string& cmd, std::string* raw){
   static const char endCommand[] = ";\n";
-  JASSERT(write(_fd, cmd, len)==len)(cmd)(JASSERT_ERRNO);
+  JASSERT(write(_fd, cmd.c_str(), cmd.length())==(ssize_t)cmd.length())(cmd)(JASSERT_ERRNO);
   JASSERT(write(_fd, endCommand, sizeof endCommand-1)==sizeof endCommand-1)(cmd)(JASSERT_ERRNO);
   fsync(_fd);
+  _record = raw;
   petabricks::FormulaListPtr result = readFormulaFromMaxima();
+  _record = NULL;
   return result;
 }
 
+void petabricks::MaximaWrapper::sync(){
+  if(_fd<0){
+#ifdef MAXIMA_LOG
+    _fd = forkopen(&launchMaximaWithLogging);
+#else
+    _fd = forkopen(&launchMaxima);
+#endif
+    readFormulaFromMaxima();//initial prompt
+    send(theInitCode, NULL);
+#ifdef DEBUG
+    JASSERT(send("666.667", NULL)->toString()=="666.667").Text("problem with maxima");
+#endif
+  }
+  for(size_t i=0; i<_deferred.size(); ++i)
+    send(_deferred[i], NULL);
+  if(_stackDepth>0)
+    _syncedInContext = true;
+  _deferred.clear();
+  _deferredAtContext = 0;
+}
+
+void petabricks::MaximaWrapper::beginOutermostContext(){
+  _contextKey = _baseKey;
+  _deferredAtContext = _deferred.size();
+  _syncedInContext = false;
+}
+
+void petabricks::MaximaWrapper::endOutermostContext(){
+  //maxima never saw this context, so it can be forgotten entirely
+  if(!_syncedInContext)
+    _deferred.resize(_deferredAtContext);
+  _syncedInContext = false;
+}
+
+int petabricks::MaximaWrapper::readChar(char* buf){
+  if(_replay != NULL){
+    if(_replayPos >= _replay->length())
+      return 0;
+    *buf = (*_replay)[_replayPos++];
+    return 1;
+  }
+  JASSERT(_fd>=0).Text("maxima is not running");
+  int rv = read(_fd, buf, 1);
+  if(rv>0 && _record!=NULL)
+    _record->push_back(*buf);
+  return rv;
+}
+
+void petabricks::MaximaWrapper::loadTranscript(const std::string& filename){
+  _transcriptFile = filename;
+  std::ifstream in(filename.c_str(), std::ios::in|std::ios::binary);
+  std::string header;
+  if(!std::getline(in, header) || header != theTranscriptHeader)
+    return;
+  uint64_t key;
+  size_t len;
+  while(in >> std::hex >> key >> std::dec >> len && in.get()=='\n'){
+    std::string raw(len, ' ');
+    if(!in.read(&raw[0], len) || in.get()!='\n')
+      break;
+    _transcript[key] = raw;
+  }
+  JTRACE("loaded maxima transcript")(filename)(_transcript.size());
+}
+
+void petabricks::MaximaWrapper::saveTranscript(){
+  if(_transcriptFile.empty())
+    return;
+  //only keep responses this run used, so stale entries do not pile up
+  std::ofstream out(_transcriptFile.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+  out << theTranscriptHeader << '\n';
+  for(TranscriptT::const_iterator i=_transcriptUsed.begin(); i!=_transcriptUsed.end(); ++i){
+    out << std::hex << i->first << std::dec << ' ' << i->second.length() << '\n';
+    out.write(i->second.data(), i->second.length());
+    out << '\n';
+  }
+  JTRACE("saved maxima transcript")(_transcriptFile)(_transcriptUsed.size())(_transcriptHits)(_transcriptMisses);
+}
+
 //run command and perform simple caching
 petabricks::FormulaListPtr petabricks::MaximaWrapper::runCommand(const std::string& cmd){
   if(!_pendingAssume.empty()) {
@@ -172,3 +330,29 @@ petabricks::FormulaListPtr petabricks::MaximaWrapper::runCommand(const std::stri
 }
 
 
+
+bool petabricks::MaximaWrapper::tryNative(const FormulaPtr& eq, AffineFormula& af){
+  if(!useNativeSimplifier())
+    return false;
+  if(AffineFormula::tryBuild(eq, af)){
+    ++_nativeHits;
+    return true;
+  }
+  ++_nativeMisses;
+  return false;
+}
+
+petabricks::MaximaWrapper::tryCompareResult petabricks::MaximaWrapper::tryCompareNative(const FormulaPtr& a, const char* op, const FormulaPtr& b){
+  AffineFormula diff, t;
+  if(!tryNative(a, diff) || !tryNative(b, t) || !diff.add(t, -1) || !diff.isConstant())
+    return UNKNOWN;
+  int s = diff.constant().sign();
+  bool rslt;
+  if     (strcmp(op,"=")==0)  rslt = (s==0);
+  else if(strcmp(op,"<")==0)  rslt = (s<0);
+  else if(strcmp(op,"<=")==0) rslt = (s<=0);
+  else if(strcmp(op,">")==0)  rslt = (s>0);
+  else if(strcmp(op,">=")==0) rslt = (s>=0);
+  else return UNKNOWN;
+  return rslt ? YES : NO;
+}
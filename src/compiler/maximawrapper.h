@@ -27,13 +27,16 @@
 #ifndef PETABRICKSMAXIMAWRAPPER_H
 #define PETABRICKSMAXIMAWRAPPER_H
 
+#include "affineformula.h"
 #include "formula.h"
 
 #include "common/jconvert.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <map>
 #include <string>
+#include <vector>
 
 #ifdef HAVE_CONFIG_H
 #  include "config.h"
@@ -55,10 +58,27 @@ public:
   /// Singleton instance
   static MaximaWrapper& instance();
 
+  ///
+  /// If true, affine queries are answered in-process without calling maxima
+  static bool& useNativeSimplifier();
+
   ///
   /// Pass a command to maxima, parse result
   FormulaListPtr runCommandRaw(const char* cmd, int len);
 
+  ///
+  /// Answer commands from the responses recorded in filename by an earlier
+  /// run where possible, maxima is only started once a command misses
+  void loadTranscript(const std::string& filename);
+
+  ///
+  /// Write the responses used by this run to the file given to loadTranscript()
+  void saveTranscript();
+
+  ///
+  /// Called by the maxima lexer for each character of input
+  int readChar(char* buf);
+
   ///
   /// Perform simple caching and call runCommandRaw
   FormulaListPtr runCommand(const std::string& cmd);
@@ -79,24 +99,38 @@ public:
   FormulaPtr floor(const FormulaPtr& eq){
     if(eq->size()==1) 
       return eq; //cant simplify a leaf node
+    AffineFormula af;
+    if(tryNative(eq, af) && af.isConstant())
+      return new FormulaInteger(af.constant().floor());
     return runCommandSingleOutput("floor(" + eq->toString() + ")");
   }
   
   FormulaPtr ceiling(const FormulaPtr& eq){
     if(eq->size()==1) 
       return eq; //cant simplify a leaf node
+    AffineFormula af;
+    if(tryNative(eq, af) && af.isConstant())
+      return new FormulaInteger(af.constant().ceiling());
     return runCommandSingleOutput("ceiling(" + eq->toString() + ")");
   }
 
   FormulaPtr staticCeiling(const FormulaPtr& eq){
     if(eq->size()==1) 
       return eq; //cant simplify a leaf node
+    AffineFormula af;
+    FormulaPtr rv;
+    if(tryNative(eq, af) && (rv = af.toStaticCeilingFormula()))
+      return rv;
     return runCommandSingleOutput("_tmp:fullratsimp("+eq->toString()+")$ fullratsimp( (num(_tmp)+denom(_tmp)-1) / denom(_tmp) )");
   }
   
   FormulaPtr normalize(const FormulaPtr& eq){
     if(eq->size()==1) 
       return eq; //cant simplify a leaf node
+    AffineFormula af;
+    FormulaPtr rv;
+    if(tryNative(eq, af) && (rv = af.toFormula()))
+      return rv;
     return runCommandSingleOutput("fullratsimp(expand(" + eq->toString() + "))");
   }
 
@@ -111,10 +145,16 @@ public:
   FormulaPtr subst(const Formula& formula, const FormulaPtr& eq){
     FormulaPtr l,r;
     formula.explodeEquality(l,r);
-    if(l->hasIntersection(eq))
-      return subst(r->toString(), l->toString(), eq);
-    else
+    if(!l->hasIntersection(eq))
       return eq;
+    AffineFormula af, with;
+    FormulaPtr rv;
+    if(dynamic_cast<const FormulaVariable*>(l.asPtr()) != NULL
+       && tryNative(eq, af) && tryNative(r, with)
+       && af.substitute(l->toString(), with)
+       && (rv = af.toFormula()))
+      return rv;
+    return subst(r->toString(), l->toString(), eq);
   }
 
   FormulaPtr diff(const Formula& formula, const Formula& var){
@@ -208,6 +248,9 @@ public:
         return NO;
       }
     }
+    tryCompareResult rslt = tryCompareNative(a, op, b);
+    if(rslt != UNKNOWN)
+      return rslt;
     return is(test);
   }
 
@@ -247,13 +290,17 @@ public:
   }
   
   void pushContext(){
+    if(_stackDepth==0)
+      beginOutermostContext();
     runCommand("supcontext(_ctx_stack_" + jalib::XToString(++_stackDepth) + ")");
   }
   
   void popContext(){
     JASSERT(_stackDepth>0);
     _pendingAssume.clear();
-    runCommand("killcontext(_ctx_stack_" + jalib::XToString(_stackDepth--) + ")");
+    runCommand("killcontext(_ctx_stack_" + jalib::XToString(_stackDepth) + ")");
+    if(--_stackDepth==0)
+      endOutermostContext();
     clearCache();
   }
 
@@ -264,13 +311,57 @@ public:
   }
 
   void clearCache(){ _cache.clear(); }
+private:
+  ///
+  /// Convert eq to affine form if the native simplifier is enabled
+  bool tryNative(const FormulaPtr& eq, AffineFormula& af);
+
+  ///
+  /// Start maxima and send it every command answered from the transcript
+  /// so far, so its state matches what our callers have seen
+  void sync();
+
+  ///
+  /// Send a command to the maxima process, if raw is given the response
+  /// text is recorded there
+  FormulaListPtr send(const std::string& cmd, std::string* raw);
+
+  ///
+  /// Contexts reset maxima to the state it had before them, so commands
+  /// inside are keyed only by what was run since the outermost one began,
+  /// and an edit to one transform does not invalidate the others
+  void beginOutermostContext();
+  void endOutermostContext();
+
+  ///
+  /// Decide a comparison whose sides differ by a constant, UNKNOWN otherwise
+  tryCompareResult tryCompareNative(const FormulaPtr& a, const char* op, const FormulaPtr& b);
 private:
   int _fd;
+  int _nativeHits;
+  int _nativeMisses;
   int _stackDepth;
   typedef std::map<std::string, FormulaListPtr> CacheT;
   typedef std::set<std::string> ContextT;
+  typedef std::map<uint64_t, std::string> TranscriptT;
   ContextT _pendingAssume;
   CacheT   _cache;
+  //commands answered from the transcript and not yet sent to maxima
+  std::vector<std::string> _deferred;
+  size_t _deferredAtContext;
+  bool _syncedInContext;
+  //hash of the commands that led to the current maxima state
+  uint64_t _baseKey;
+  uint64_t _contextKey;
+  std::string _transcriptFile;
+  TranscriptT _transcript;
+  TranscriptT _transcriptUsed;
+  int _transcriptHits;
+  int _transcriptMisses;
+  //response being replayed to or recorded from the lexer
+  const std::string* _replay;
+  size_t _replayPos;
+  std::string* _record;
 };
 
 }
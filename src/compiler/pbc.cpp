@@ -45,6 +45,8 @@
 #endif
 
 
+#include <algorithm>
+#include <dirent.h>
 #include <fstream>
 #include <iostream>
 #include <sys/stat.h>
@@ -84,7 +86,11 @@ namespace pbcConfig {
   std::string thePbPreprocessor;
   std::string theBasename;
   std::string theHeuristicsFile;
+  std::string theSpecializeConfig;
   int theNJobs = 2;
+  bool theVectorize = true;
+  bool thePerfCounters = false;
+  bool theIncremental = false;
 }
 using namespace pbcConfig;
 
@@ -113,6 +119,74 @@ void closesubproc(FILE* p, const std::string& name) {
 }
 
 
+/* contents of filename, or empty if it can not be read */
+static std::string readFile(const std::string& filename) {
+  std::ifstream in(filename.c_str(), std::ios::in|std::ios::binary);
+  std::ostringstream os;
+  os << in.rdbuf();
+  return os.str();
+}
+
+/* true if a exists and was modified after b */
+static bool isNewer(const std::string& a, const std::string& b) {
+  struct stat sa, sb;
+  if(stat(a.c_str(), &sa)!=0 || stat(b.c_str(), &sb)!=0)
+    return false;
+  return sa.st_mtime > sb.st_mtime;
+}
+
+/* path, mtime and size of a file, one line; used to detect changed inputs */
+static std::string fileStamp(const std::string& filename) {
+  struct stat st;
+  std::ostringstream os;
+  if(stat(filename.c_str(), &st)==0)
+    os << filename << ' ' << st.st_mtime << ' ' << st.st_size << '\n';
+  else
+    os << filename << " missing\n";
+  return os.str();
+}
+
+/* stamps of every header in dir, in sorted order */
+static std::string headerStamps(const std::string& dir) {
+  std::vector<std::string> names;
+  DIR* d = opendir(dir.c_str());
+  if(d != NULL){
+    for(struct dirent* e=readdir(d); e!=NULL; e=readdir(d)){
+      std::string n = e->d_name;
+      if(n.size()>2 && n.substr(n.size()-2)==".h")
+        names.push_back(n);
+    }
+    closedir(d);
+  }
+  std::sort(names.begin(), names.end());
+  std::string rv;
+  for(size_t i=0; i<names.size(); ++i)
+    rv += fileStamp(dir+"/"+names[i]);
+  return rv;
+}
+
+/* the runtime headers and libraries generated objects are built against */
+static const std::string& runtimeStamp() {
+  static std::string stamp;
+  if(stamp.empty()){
+    stamp = headerStamps(theRuntimeDir)
+          + headerStamps(theLibDir+"/common")
+          + fileStamp(theLibDir+"/libpbruntime.a")
+          + fileStamp(theLibDir+"/libpbcommon.a");
+  }
+  return stamp;
+}
+
+/* write contents to filename, unless it already holds exactly that */
+static void writeIfChanged(const std::string& filename, const std::string& contents) {
+  if(theIncremental && readFile(filename)==contents)
+    return;
+  std::ofstream of(filename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+  of << contents;
+  of.flush();
+  of.close();
+}
+
 /**
  * Small helper class used to output cpp files and call gcc
  */
@@ -140,23 +214,39 @@ public:
   }
 
   void write() {
-    std::ofstream of(_cpp.c_str());
+    std::ostringstream of;
     of << headertxtcpp;
     of << "/* Compile with: \n"
        <<  _gcccmd << "\n"
        << " */\n";
     _code->writeTo(of);
-    of.flush();
-    of.close();
+    writeIfChanged(_cpp, of.str());
+  }
+
+  /// everything _obj depends on; written to _obj.stamp after gcc succeeds
+  std::string inputStamp() const {
+    return _gcccmd + "\n" + fileStamp(_cpp) + fileStamp(GENHEADER) + runtimeStamp();
   }
 
   void forkCompile() {
+    std::string stampfile = _obj+".stamp";
+    if(theIncremental && isNewer(_obj, _cpp) && readFile(stampfile)==inputStamp()) {
+      JTRACE("reusing object")(_obj);
+      return;
+    }
+    //a compile that does not finish must not leave a usable stamp behind
+    unlink(stampfile.c_str());
     JTRACE(_gcccmd.c_str());
     _gccfd = opensubproc(_gcccmd);
   }
 
   void waitCompile() {
-    closesubproc(_gccfd, "Compile "+_cpp);
+    if(_gccfd != 0){
+      closesubproc(_gccfd, "Compile "+_cpp);
+      if(theIncremental)
+        writeIfChanged(_obj+".stamp", inputStamp());
+    }
+    _gccfd = 0;
   }
 
   const std::string& objpath() const { return _obj; }
@@ -176,10 +266,10 @@ public:
 class OutputCodeList : public std::vector<OutputCode> {
 public:
   void writeHeader(const StreamTreePtr& h) {
-    std::ofstream of((theObjDir+"/"GENHEADER).c_str());
+    //an unchanged header keeps its timestamp so objects can be reused
+    std::ostringstream of;
     h->writeTo(of);
-    of.flush();
-    of.close();
+    writeIfChanged(theObjDir+"/"GENHEADER, of.str());
   }
 
   void write() {
@@ -257,6 +347,7 @@ void loadDefaultHeuristics() {
   HeuristicManager& hm = HeuristicManager::instance();
   
   hm.registerDefault("UserRule_blockNumber", "2");
+  hm.registerDefault("UserRule_unrollLimit", "0");
 }
 
 void findMainTransform(const TransformListPtr& t) {
@@ -308,8 +399,13 @@ int main( int argc, const char ** argv){
   args.param("link",       shouldLink).help("disable the linking step");
   args.param("main",       theMainName).help("transform name to use as program entry point");
   args.param("hardcode",   theHardcodedConfig).help("a config file containing tunables to set to hardcoded values");
+  args.param("specialize-config", theSpecializeConfig).help("a trained config file to hardcode, only code for the choices it selects is generated");
   args.param("jobs",       theNJobs).help("number of gcc processes to call at once");
   args.param("heuristics", theHeuristicsFile).help("config file containing the (partial) set of heuristics to use");
+  args.param("nativesimplify", MaximaWrapper::useNativeSimplifier()).help("simplify affine formulas in-process instead of calling maxima");
+  args.param("vectorize",  theVectorize).help("order cell loops unit stride innermost and mark independent loops for vectorization");
+  args.param("perfcounters", thePerfCounters).help("instrument rules and transforms for the runtime --perfcounters option");
+  args.param("incremental", theIncremental).help("reuse maxima results, generated files and objects from the previous build in the objdir (off by default)");
   
   if(args.param("version").help("print out version number and exit") ){
     std::cerr << PACKAGE " compiler (pbc) v" VERSION " " REVISION_LONG << std::endl;
@@ -344,10 +440,19 @@ int main( int argc, const char ** argv){
   if(rv!=0 && errno==EEXIST)
     rv=0, errno=0;
   JASSERT(rv==0)(theObjDir).Text("failed to create objdir");
+
+  if(theIncremental)
+    MAXIMA.loadTranscript(theObjDir+"/"MAXIMA_CACHE);
   
   if(!theHardcodedConfig.empty())
     CodeGenerator::theHardcodedTunables() = jalib::JTunableManager::loadRaw(theHardcodedConfig);
 
+  if(!theSpecializeConfig.empty()) {
+    jalib::TunableValueMap trained = jalib::JTunableManager::loadRaw(theSpecializeConfig);
+    for(jalib::TunableValueMap::const_iterator i=trained.begin(); i!=trained.end(); ++i)
+      CodeGenerator::theHardcodedTunables()[i->first] = i->second;
+  }
+
   JASSERT(jalib::Filesystem::FileExists(theInput))(theInput)
     .Text("input file does not exist");
 
@@ -426,6 +531,7 @@ int main( int argc, const char ** argv){
   *prefix << "} \n";
   o.outputTunableHeaders(*prefix);
   ccfiles.writeHeader(header);
+  MAXIMA.saveTranscript();
 
   // dump .info file:
   std::ofstream infofile(theOutputInfo.c_str());
@@ -469,6 +575,8 @@ int main( int argc, const char ** argv){
   MAXIMA.sanityCheck();
 #endif
 
+  HeuristicManager& hm = HeuristicManager::instance();
+  JTRACE("heuristics")(hm.lookups())(hm.lookupTime())(hm.loadTime());
   JTRACE("done")(theInput)(theOutputInfo)(theObjDir)(theOutputBin);
   return 0;
 }
@@ -41,6 +41,10 @@
 namespace pbcConfig {
 extern std::string thePbPreprocessor;
 extern std::string theObjDir;
+extern bool theVectorize;
+extern bool thePerfCounters;
+extern bool theIncremental;
+extern std::string theSpecializeConfig;
 }
 
 namespace petabricks
@@ -499,13 +499,13 @@ std::string petabricks::Region::genTypeStr(RuleFlavor rf, bool isConst) const{
   case REGION_CELL:
     if(isConst){
       if(rf != RuleFlavor::DISTRIBUTED) {
-        return "const ElementT";
+        return "const "+_fromMatrix->elementTypeName();
       }else{
         return "CellProxy";
       }
     }else{
       if(rf != RuleFlavor::DISTRIBUTED) {
-        return "ElementT&";
+        return _fromMatrix->elementTypeName()+"&";
       }else{
         return "CellProxy";
       }
@@ -31,6 +31,7 @@
 
 #include "common/jconvert.h"
 
+#include <algorithm>
 #include <cstring>
 
 namespace {//file local
@@ -78,9 +79,17 @@ void petabricks::DynamicBodyPrintPass::before(RIRStmtCopyRef& s) {
     }
     break;
   case RIRNode::STMT_LOOP:
+  case RIRNode::STMT_SWITCH:
+    if(!s->containsLeaf("SYNC") && !s->containsLeaf("CALL")
+        && (s->type() == RIRNode::STMT_LOOP || !s->containsLeaf("continue"))){
+      // break (and continue, for loops) bind to this statement and SPAWN only
+      // enqueues, so it runs in place and spawned iterations proceed in parallel
+      o.write(s->toString());
+      break;
+    }
+    //fall through
   case RIRNode::STMT_COND:
   case RIRNode::STMT_BLOCK:
-  case RIRNode::STMT_SWITCH:
     if(s->containsLeaf("SYNC") || s->containsLeaf("CALL") || s->containsLeaf("SPAWN")
         || s->containsLeaf("break")  || s->containsLeaf("continue") ){
       if(s->type() == RIRNode::STMT_COND){
@@ -109,9 +118,11 @@ void petabricks::DynamicBodyPrintPass::before(RIRStmtCopyRef& s) {
         std::string jafter = o.nextContName("after_");
         o.write(stmt.declPart()->toString()+";");
         o.continueLabel(jbody);
-        o.beginIfNot(stmt.testPart()->toString());
-        o.continueJump(jafter);
-        o.endIf();
+        if(stmt.testPart()->type() != RIRNode::EXPR_NIL){
+          o.beginIfNot(stmt.testPart()->toString());
+          o.continueJump(jafter);
+          o.endIf();
+        }
         _breakTargets.push_back(jafter);
         _continueTargets.push_back(jinc);
         stmt.body()->extractBlock()->accept(*this);
@@ -119,13 +130,13 @@ void petabricks::DynamicBodyPrintPass::before(RIRStmtCopyRef& s) {
         _breakTargets.pop_back();
         o.continueLabel(jinc);
         o.write(stmt.incPart()->toString()+";");
-        o.continueJump(jbody);
+        o.continueLoop(jbody);
         o.continueLabel(jafter);
       }else if(s->type() == RIRNode::STMT_BLOCK){
         o.comment("expanded block statement");
         s->extractBlock()->accept(*this);
       }else{
-        UNIMPLEMENTED();
+        JASSERT(false)(s->toString()).Text("SYNC, CALL and continue are not supported inside switch statements");
       }
     }else{
       o.write(s->toString());
@@ -217,7 +228,8 @@ void petabricks::ExpansionPass::before(RIRStmtCopyRef& s){
     s->removeAnnotation("for_enough");
     RIRLoopStmt& loop = (RIRLoopStmt&)*s;
     RIRStmtCopyRef t;
-    JASSERT(s->numExprs()==5)(s->numExprs());
+    JASSERT(s->numExprs()==6)(s->numExprs());
+    RIRExprCopyRef untilExp = s->popExpr();
     RIRExprCopyRef maxExp = s->popExpr();
     RIRExprCopyRef minExp = s->popExpr();
     int minI = jalib::StringToX<int>(minExp->toString());
@@ -227,14 +239,26 @@ void petabricks::ExpansionPass::before(RIRStmtCopyRef& s){
     std::string vI=         _uniquify("_forenough_i");
     std::string vCount=     _uniquify("_forenough_count");
     //std::string vIsTraining=_uniquify("_forenough_isTraining");
+    bool hasUntil = untilExp->type() != RIRNode::EXPR_NIL;
     _transform.addConfigItem(
         ConfigItem::FLAG_FROMCFG|ConfigItem::FLAG_SIZESPECIFIC|ConfigItem::FLAG_ACCURACY|ConfigItem::FLAG_TUNABLE,
-        config, minI, minI, maxI);
+        config, hasUntil ? maxI : minI, minI, maxI);
 
     // set the iteration bounds
     loop.declPart() = RIRExpr::parse("int "+vI+" = 0", SRCPOS());
-    loop.testPart() = RIRExpr::parse(vI+" < "+config, SRCPOS());
     loop.incPart()  = RIRExpr::parse("++"+vI, SRCPOS());
+    if(hasUntil){
+      // the convergence test is costly, so how often it runs is tuned
+      std::string checkEvery = _uniquify("forenough_checkevery");
+      _transform.addConfigItem(
+          ConfigItem::FLAG_FROMCFG|ConfigItem::FLAG_SIZESPECIFIC|ConfigItem::FLAG_TUNABLE,
+          checkEvery, 1, 1, std::max(1, maxI-minI));
+      loop.testPart() = RIRExpr::parse(vI+" < "+config+" && !("+vI+" >= "+minExp->toString()
+                                       +" && ("+vI+" - "+minExp->toString()+") % "+checkEvery+" == 0"
+                                       +" && ("+untilExp->toString()+"))", SRCPOS());
+    }else{
+      loop.testPart() = RIRExpr::parse(vI+" < "+config, SRCPOS());
+    }
   }
 }
 
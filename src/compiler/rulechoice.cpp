@@ -28,6 +28,7 @@
 
 #include "codegenerator.h"
 #include "maximawrapper.h"
+#include "pbc.h"
 #include "rule.h"
 #include "scheduler.h"
 #include "syntheticrule.h"
@@ -120,9 +121,68 @@ void petabricks::RuleChoiceCollection::pruneChoiceSpace() {
   JTRACE("combined")(size());
 }
 
+namespace {
+  bool lookupHardcoded(const std::string& name, int& out) {
+    const jalib::TunableValueMap& hc = petabricks::CodeGenerator::theHardcodedTunables();
+    jalib::TunableValueMap::const_iterator i = hc.find(name);
+    if(i == hc.end() || !i->second.isInt())
+      return false;
+    out = i->second.i();
+    return true;
+  }
+}
+
+std::set<int> petabricks::RuleChoiceCollection::reachableChoices(const std::string& pfx, size_t choiceCount) const {
+  std::set<int> rv;
+  int lowerBound = 0;
+  for(int lvl = 1; lvl<=MAX_REC_LEVELS; ++lvl) {
+    int rule, cutoff = jalib::maxval<int>();
+    if(!lookupHardcoded(pfx + "lvl" + jalib::XToString(lvl) + "_rule", rule)
+       || rule < 0 || rule >= (int)choiceCount)
+      return std::set<int>();
+    if(lvl<MAX_REC_LEVELS && !lookupHardcoded(pfx + "lvl" + jalib::XToString(lvl+1) + "_cutoff", cutoff))
+      return std::set<int>();
+    //this level handles _transform_n in [lowerBound, cutoff)
+    if(cutoff > lowerBound)
+      rv.insert(rule);
+    if(cutoff >= jalib::maxval<int>())
+      break;
+    lowerBound = std::max(lowerBound, cutoff);
+  }
+  return rv;
+}
+
 void petabricks::RuleChoiceCollection::generateDecisionTree(std::string& pfx, size_t choiceCount, CodeGenerator& o) {
   o.cg().addAlgchoice(pfx.substr(0, pfx.length()-1), (int)choiceCount);
 
+  if(!pbcConfig::theSpecializeConfig.empty() && !reachableChoices(pfx, choiceCount).empty()) {
+    //every tunable in the tree is hardcoded, emit it with the constants folded in
+    int lowerBound = 0;
+    for(int lvl = 1; lvl<=MAX_REC_LEVELS; ++lvl) {
+      std::string rule   = pfx + "lvl" + jalib::XToString(lvl) + "_rule";
+      std::string cutoff = pfx + "lvl" + jalib::XToString(lvl+1) + "_cutoff";
+      o.createTunable(true, "algchoice.alg", rule, 0, 0, (int)choiceCount-1);
+      if(lvl<MAX_REC_LEVELS)
+        o.createTunable(true, "algchoice.cutoff", cutoff, jalib::maxval<int>(), 1);
+      if(lowerBound >= jalib::maxval<int>())
+        continue; //unreachable, keep declaring tunables so the config still matches
+
+      int ruleValue, cutoffValue = jalib::maxval<int>();
+      lookupHardcoded(rule, ruleValue);
+      if(lvl<MAX_REC_LEVELS)
+        lookupHardcoded(cutoff, cutoffValue);
+      if(cutoffValue >= jalib::maxval<int>()) {
+        o.write("return "+jalib::XToString(ruleValue)+";");
+      } else if(cutoffValue > lowerBound) {
+        o.beginIf("_transform_n < "+jalib::XToString(cutoffValue));
+        o.write("return "+jalib::XToString(ruleValue)+";");
+        o.endIf();
+      }
+      lowerBound = std::max(lowerBound, cutoffValue);
+    }
+    return;
+  }
+
   for(int lvl = 1; lvl<=MAX_REC_LEVELS; ++lvl) {
     std::string rule   = pfx + "lvl" + jalib::XToString(lvl) + "_rule";
     o.createTunable(true, "algchoice.alg", rule, 0, 0, (int)choiceCount-1);
@@ -30,6 +30,8 @@
 #include "formula.h"
 #include "rule.h"
 
+#include <set>
+
 namespace petabricks {
 class CodeGenerator;
 class RuleChoice;
@@ -71,6 +73,11 @@ public:
 
   void generateDecisionTree(std::string& prefix, size_t choiceCount, CodeGenerator& o);
 
+  ///
+  /// Choices the decision tree can return given the hardcoded tunables,
+  /// empty if any tunable in the tree is left to the runtime config
+  std::set<int> reachableChoices(const std::string& prefix, size_t choiceCount) const;
+
   void pruneChoiceSpace();
 
 private:
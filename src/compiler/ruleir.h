@@ -291,8 +291,12 @@ public:
   RIRExprCopyRef& incPart() { return part(2); }
   RIRStmtCopyRef& body() { return _body; }
 
+  ///
+  /// for_enough(min; max; until) stops early, once until holds at a check
+  /// point after min iterations
   RIRLoopStmt* initForEnough(const RIRExprCopyRef& min = new RIRLitExpr(jalib::XToString(FORENOUGH_MIN_ITERS)),
-                             const RIRExprCopyRef& max = new RIRLitExpr(jalib::XToString(FORENOUGH_MAX_ITERS)))
+                             const RIRExprCopyRef& max = new RIRLitExpr(jalib::XToString(FORENOUGH_MAX_ITERS)),
+                             const RIRExprCopyRef& until = new RIRNilExpr())
   {
     addAnnotation("for_enough");
     addExpr(new RIRNilExpr());
@@ -300,6 +304,7 @@ public:
     addExpr(new RIRNilExpr());
     addExpr(min);
     addExpr(max);
+    addExpr(until);
     return this;
   }
 private:
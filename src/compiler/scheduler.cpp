@@ -30,6 +30,7 @@
 #include "pbc.h"
 #include "transform.h"
 #include "maximawrapper.h"
+#include "userrule.h"
 #include "heuristicmanager.h"
 #include "common/jasm.h"
 
@@ -97,6 +98,113 @@ void petabricks::Schedule::depthFirstChoiceDepGraphNode(SchedulingState& state,
   state.generated.insert(n);
 }
 
+namespace {
+  //only simple cell-wise user rules are fused, calling them on a block of
+  //their region does the same work as that part of the full call
+  petabricks::BasicChoiceDepGraphNode* fusibleNode(petabricks::ChoiceDepGraphNode& n,
+                                                   const petabricks::RuleChoiceAssignment& choice,
+                                                   int d) {
+    using namespace petabricks;
+    BasicChoiceDepGraphNode* basic = dynamic_cast<BasicChoiceDepGraphNode*>(&n);
+    if(basic==NULL || basic->isInput())
+      return NULL;
+    RuleChoiceAssignment::const_iterator c = choice.find(basic);
+    if(c==choice.end())
+      return NULL;
+    UserRule* rule = dynamic_cast<UserRule*>(c->second.asPtr());
+    if(rule==NULL || rule->isSingleCall() || rule->isRecursive() || rule->isEnabledGpuRule())
+      return NULL;
+    if(d >= rule->dimensions() || d >= (int)basic->region()->dimensions())
+      return NULL;
+    if(rule->getSizeOfRuleIn(d)->toString() != "1")
+      return NULL;
+    return basic;
+  }
+
+  //narrow the legal block orders along d so consumer sees all of producer it reads
+  bool restrictDirections(petabricks::ChoiceDepGraphNode& consumer,
+                          petabricks::ChoiceDepGraphNode& producer,
+                          int d, bool& forward, bool& backward) {
+    using namespace petabricks;
+    ScheduleDependencies::const_iterator i = consumer.indirectDepends().find(&producer);
+    if(i == consumer.indirectDepends().end())
+      return true;
+    const DependencyDirection& dir = i->second.direction;
+    if(dir.isMultioutput() || (size_t)d >= dir.size())
+      return false;
+    if((dir[d] & DependencyDirection::D_GT) != 0) forward = false;
+    if((dir[d] & DependencyDirection::D_LT) != 0) backward = false;
+    return forward || backward;
+  }
+}
+
+petabricks::Schedule::ScheduleT::iterator petabricks::Schedule::findFusibleRun(ScheduleT::iterator first, int& dimension, bool& forward){
+  ScheduleT::iterator best = first;
+  for(int d=MAX_DIMENSIONS-1; d>=0; --d){
+    BasicChoiceDepGraphNode* head = fusibleNode(first->node(), _choiceAssignment, d);
+    if(head == NULL)
+      continue;
+    bool fwd=true, bwd=true;
+    if(!restrictDirections(*head, *head, d, fwd, bwd))
+      continue;
+    ScheduleT::iterator last = first;
+    for(ScheduleT::iterator j=first+1; j!=_schedule.end(); ++j){
+      BasicChoiceDepGraphNode* n = fusibleNode(j->node(), _choiceAssignment, d);
+      if(n == NULL
+        || n->region()->minCoord()[d]->toString() != head->region()->minCoord()[d]->toString()
+        || n->region()->maxCoord()[d]->toString() != head->region()->maxCoord()[d]->toString())
+        break;
+      bool f=fwd, b=bwd, ok=true;
+      for(ScheduleT::iterator k=first; ok && k<=j; ++k)
+        ok = restrictDirections(*n, k->node(), d, f, b);
+      if(!ok)
+        break;
+      fwd=f;
+      bwd=b;
+      last=j;
+    }
+    if(last-first > best-first){
+      best = last;
+      dimension = d;
+      forward = fwd;
+    }
+  }
+  return best;
+}
+
+void petabricks::Schedule::generateFusedCode(Transform& trans, CodeGenerator& o, ScheduleT::iterator first, ScheduleT::iterator last, int d, bool forward){
+  BasicChoiceDepGraphNode& head = first->node().asBasicNode();
+  std::string blocksize = trans.name()+"_"+head.nodename()+"_fuseblock";
+  std::string var = "fused_"+head.nodename();
+  std::string begin = head.region()->minCoord()[d]->toString();
+  std::string end = head.region()->maxCoord()[d]->toString();
+
+  //block size of 0 keeps the nodes in separate loops, the autotuner decides
+  o.createTunable(true, "system.size.tile", blocksize, 0, 0, 4096);
+  o.beginIf(blocksize+" > 0");
+  o.comment("Fused loop over "+jalib::XToString(last-first+1)+" nodes along dimension "+jalib::XToString(d));
+  if(forward){
+    o.write("for(IndexT "+var+"_begin="+begin+"; "+var+"_begin<"+end+"; "+var+"_begin+="+blocksize+"){");
+    o.incIndent();
+    o.write("const IndexT "+var+"_end = std::min<IndexT>("+var+"_begin+"+blocksize+", "+end+");");
+  }else{
+    o.write("for(IndexT "+var+"_end="+end+"; "+var+"_end>"+begin+"; "+var+"_end-="+blocksize+"){");
+    o.incIndent();
+    o.write("const IndexT "+var+"_begin = std::max<IndexT>("+var+"_end-"+blocksize+", "+begin+");");
+  }
+  FormulaPtr b = new FormulaVariable(var+"_begin");
+  FormulaPtr e = new FormulaVariable(var+"_end");
+  for(ScheduleT::iterator i=first; i<=last; ++i){
+    i->node().asBasicNode().generateCodeForBlock(trans, o, d, b, e, _choiceAssignment);
+  }
+  o.endFor();
+  o.elseIf();
+  for(ScheduleT::iterator i=first; i<=last; ++i){
+    i->node().generateCode(trans, o, RuleFlavor::SEQUENTIAL, _choiceAssignment);
+  }
+  o.endIf();
+}
+
 void petabricks::Schedule::generateCode(Transform& trans, CodeGenerator& o, RuleFlavor flavor, int n){
   JASSERT(_schedule.size()>0);
   o.comment("MARKER 1");
@@ -188,6 +296,17 @@ void petabricks::Schedule::generateCode(Transform& trans, CodeGenerator& o, Rule
     if(i!=_schedule.begin() && flavor!=RuleFlavor::SEQUENTIAL)
       o.continuationPoint();
 
+    if(flavor==RuleFlavor::SEQUENTIAL) {
+      int d = -1;
+      bool forward = true;
+      ScheduleT::iterator last = findFusibleRun(i, d, forward);
+      if(last != i) {
+        generateFusedCode(trans, o, i, last, d, forward);
+        i = last;
+        continue;
+      }
+    }
+
     i->node().generateCode(trans, o, flavor, _choiceAssignment);
 
     if(flavor!=RuleFlavor::SEQUENTIAL) {
@@ -637,10 +756,26 @@ void petabricks::StaticScheduler::generateCode(Transform& trans, CodeGenerator&
   int n=0;
   if(_schedules.size()==1) {
     o.beginSwitch("0");
+  }else if(_reachableSchedules.size()==1) {
+    o.beginSwitch(jalib::XToString(*_reachableSchedules.begin()));
   }else{
-    o.beginSwitch(trans.name()+"_selectSchedule("TRANSFORM_N_STR"())");
+    o.write("const IndexT _choice_n = "TRANSFORM_N_STR"();");
+    o.write("static petabricks::ChoiceSite _choicesite(\""+_choiceName+"\");");
+    if(flavor==RuleFlavor::SEQUENTIAL) {
+      o.write("const int _choice_default = "+trans.name()+"_selectSchedule(_choice_n);");
+      o.write("const int _choice = petabricks::OnlineTuner::choose(_choicesite, _choice_n, _choice_default);");
+      o.write("petabricks::ChoiceProfileScope _choiceprofile(_choicesite, _choice_n, _choice, _choice_default);");
+    } else {
+      o.write("const int _choice = "+trans.name()+"_selectSchedule(_choice_n);");
+      o.write("petabricks::ChoiceProfiler::record(_choicesite, _choice_n, _choice);");
+    }
+    o.beginSwitch("_choice");
   }
   for(i=_schedules.begin(); i!=_schedules.end(); ++i,++n) {
+    if(!_reachableSchedules.empty() && _reachableSchedules.count(n)==0) {
+      //pruned by --specialize-config, the decision tree never selects it
+      continue;
+    }
     o.beginCase(n);
 
     if(flavor==RuleFlavor::SEQUENTIAL){
@@ -667,10 +802,16 @@ void petabricks::StaticScheduler::generateCode(Transform& trans, CodeGenerator&
 
 void petabricks::StaticScheduler::generateGlobalCode(Transform& trans, CodeGenerator& o) {
   std::string prefix = trans.name() + "_" + jalib::XToString(trans.nextTunerId()) + "_";
+  _choiceName = prefix.substr(0, prefix.length()-1);
+  _reachableSchedules.clear();
   if(_schedules.size()>1) {
     o.beginFunc("int", trans.name()+"_selectSchedule", std::vector<std::string>(1,"int _transform_n"));
     _choices.generateDecisionTree(prefix, _schedules.size(), o);
     o.endFunc();
+    if(!pbcConfig::theSpecializeConfig.empty()) {
+      _reachableSchedules = _choices.reachableChoices(prefix, _schedules.size());
+      JTRACE("specialized schedules")(trans.name())(_schedules.size())(_reachableSchedules.size());
+    }
   }
 }
 
@@ -133,6 +133,16 @@ protected:
 private:
   // the ordering
   typedef std::vector<ScheduleEntry> ScheduleT;
+
+  ///
+  /// Find the longest run of entries starting at first that can share one
+  /// loop blocked along dimension, returns first if nothing can be fused
+  ScheduleT::iterator findFusibleRun(ScheduleT::iterator first, int& dimension, bool& forward);
+
+  ///
+  /// Emit [first, last] as one blocked loop, guarded by a tunable block size
+  void generateFusedCode(Transform& trans, CodeGenerator& o, ScheduleT::iterator first, ScheduleT::iterator last, int dimension, bool forward);
+
   ScheduleT _schedule;
   RuleChoiceAssignment _choiceAssignment;
 
@@ -346,6 +356,12 @@ private:
 
   RuleChoiceCollection _choices;
 
+  //algchoice name of the schedule selector, also the runtime ChoiceSite name
+  std::string _choiceName;
+
+  //schedules selectable under --specialize-config, empty if all are
+  std::set<int> _reachableSchedules;
+
   std::string _dbgpath;
 };
 
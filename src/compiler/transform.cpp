@@ -718,6 +718,8 @@ void petabricks::Transform::generateTransformInstanceClass(CodeGenerator& o, Rul
 
   if(rf == RuleFlavor::SEQUENTIAL) {
     o.beginFunc("void", "run");
+    if(pbcConfig::thePerfCounters)
+      o.perfScope(instClassName()+"_"+rf.str(), "TRANSFORM", "0", false);
     if(_memoized){
       o.beginIf("tryMemoize()");
       o.write("return;");
@@ -727,6 +729,12 @@ void petabricks::Transform::generateTransformInstanceClass(CodeGenerator& o, Rul
     o.endFunc();
   }else{
     o.beginFunc("DynamicTaskPtr", "run");
+    if(pbcConfig::thePerfCounters){
+      o.comment("run() only spawns the work, so just count the invocation");
+      o.write("{");
+      o.perfScope(instClassName()+"_"+rf.str(), "TRANSFORM", "0", true);
+      o.write("}");
+    }
     if(_memoized){
       o.beginIf("tryMemoize()");
       o.write("return NULL;");
@@ -791,10 +799,16 @@ void petabricks::Transform::declTryMemoizeFunc(CodeGenerator& o){
   SRCPOSSCOPE();
   o.beginFunc("bool", "tryMemoize");
   std::string abortCond = "false";
-  for(MatrixDefList::const_iterator i=_to.begin(); i!=_to.end(); ++i)
+  for(MatrixDefList::const_iterator i=_to.begin(); i!=_to.end(); ++i){
+    JASSERT((*i)->hasDefaultElementType())((*i)->name())
+      .Text("memoized transforms only support the default element type");
     abortCond += " || !"+(*i)->name()+".isEntireBuffer()";
-  for(MatrixDefList::const_iterator i=_from.begin(); i!=_from.end(); ++i)
+  }
+  for(MatrixDefList::const_iterator i=_from.begin(); i!=_from.end(); ++i){
+    JASSERT((*i)->hasDefaultElementType())((*i)->name())
+      .Text("memoized transforms only support the default element type");
     abortCond += " || !"+(*i)->name()+".isEntireBuffer()";
+  }
   o.beginIf(abortCond);
   o.write("return false;");
   o.endIf();
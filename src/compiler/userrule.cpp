@@ -32,12 +32,14 @@
 #define TRACE JTRACE
 
 #define MAX_BLOCK_SIZE 16
+#define MAX_UNROLL 8
 //#define BLOCK_SIZE_X 16
 //#define BLOCK_SIZE_Y 16
 
 #include "userrule.h"
 
 #include "maximawrapper.h"
+#include "pbc.h"
 #include "rircompilerpass.h"
 #include "scheduler.h"
 #include "transform.h"
@@ -696,7 +698,13 @@ void petabricks::UserRule::performExpansion(Transform& trans){
     }
   }
  #ifdef HAVE_OPENCL
-  if(!hasWhereClause() && getMaxOutputDimension() > 0){
+  //kernels are generated for MATRIX_ELEMENT_T only
+  bool defaultTypes = true;
+  for(RegionList::iterator i=_to.begin(); i!=_to.end(); ++i)
+    defaultTypes = defaultTypes && (*i)->matrix()->hasDefaultElementType();
+  for(RegionList::iterator i=_from.begin(); i!=_from.end(); ++i)
+    defaultTypes = defaultTypes && (*i)->matrix()->hasDefaultElementType();
+  if(!hasWhereClause() && getMaxOutputDimension() > 0 && defaultTypes){
     _gpuRule = new GpuRule( this );
     trans.addRule( _gpuRule );
   }
@@ -1101,32 +1109,29 @@ void petabricks::UserRule::generateTrampCode(Transform& trans, CodeGenerator& o,
 
     if(isSingleElement()){
       trans.markSplitSizeUse(o);
-      Heuristic blockNumberHeur = HeuristicManager::instance().getHeuristic("UserRule_blockNumber");
-      blockNumberHeur.setMin(2);
-      unsigned int blockNumber = blockNumberHeur.eval(ValueMap()); /**< The number of blocks the loop will be
-                                                                    * splitted into */
-      // JTRACE("LOOP BLOCKING")(blockNumber);
+      std::string blockNumber = generateSplitBlockNumber(trans, o); /**< The number of blocks the loop will be
+                                                                     * splitted into */
 
       if (flavor == RuleFlavor::DISTRIBUTED) {
-        o.beginIf("petabricks::split_condition<"+jalib::XToString(dimensions())+", "+jalib::XToString(blockNumber)+">(distributedcutoff,"COORD_BEGIN_STR","COORD_END_STR")");
+        o.beginIf("petabricks::split_condition<"+jalib::XToString(dimensions())+">(distributedcutoff,"+blockNumber+","COORD_BEGIN_STR","COORD_END_STR")");
 
         // Can distribute apply task across nodes
-        iterdef.genSplitCode(o, trans, *this, flavor, blockNumber, SpatialCallTypes::DISTRIBUTED);
+        generateSplitSwitch(trans, o, iterdef, flavor, SpatialCallTypes::DISTRIBUTED);
       }
 
       if (flavor == RuleFlavor::DISTRIBUTED) {
         if (isRecursive()) {
-          std::string splitCondition = "petabricks::split_condition<"+jalib::XToString(dimensions())+", "+jalib::XToString(blockNumber)+">("SPLIT_CHUNK_SIZE_DISTRIBUTED","COORD_BEGIN_STR","COORD_END_STR")";
+          std::string splitCondition = "petabricks::split_condition<"+jalib::XToString(dimensions())+">("SPLIT_CHUNK_SIZE_DISTRIBUTED","+blockNumber+","COORD_BEGIN_STR","COORD_END_STR")";
           o.elseIf(splitCondition);
 
           // Can spawn distributed tasks
-          iterdef.genSplitCode(o, trans, *this, flavor, blockNumber, SpatialCallTypes::NORMAL);
+          generateSplitSwitch(trans, o, iterdef, flavor, SpatialCallTypes::NORMAL);
         }
 
       } else {
-        std::string splitCondition = "petabricks::split_condition<"+jalib::XToString(dimensions())+", "+jalib::XToString(blockNumber)+">("SPLIT_CHUNK_SIZE","COORD_BEGIN_STR","COORD_END_STR")";
+        std::string splitCondition = "petabricks::split_condition<"+jalib::XToString(dimensions())+">("SPLIT_CHUNK_SIZE","+blockNumber+","COORD_BEGIN_STR","COORD_END_STR")";
         o.beginIf(splitCondition);
-        iterdef.genSplitCode(o, trans, *this, flavor, blockNumber, SpatialCallTypes::NORMAL);
+        generateSplitSwitch(trans, o, iterdef, flavor, SpatialCallTypes::NORMAL);
       }
 
       // return written in get split code
@@ -1241,9 +1246,7 @@ void petabricks::UserRule::generateTrampCode(Transform& trans, CodeGenerator& o,
         }
 
       } else {
-        iterdef.genLoopBegin(o);
-        generateTrampCellCodeSimple( trans, o, flavor );
-        iterdef.genLoopEnd(o);
+        generateTrampCellLoop( trans, o, iterdef, flavor );
       }
     }
 
@@ -1534,16 +1537,13 @@ void petabricks::UserRule::generatePartialTrampCode(Transform& trans, CodeGenera
 
   if(isSingleElement()){
     trans.markSplitSizeUse(o);
-    Heuristic blockNumberHeur = HeuristicManager::instance().getHeuristic("UserRule_blockNumber");
-    blockNumberHeur.setMin(2);
-    unsigned int blockNumber = blockNumberHeur.eval(ValueMap()); /**< The number of blocks the loop will be
-                                                                  * splitted into */
-    // JTRACE("LOOP BLOCKING")(blockNumber);
+    std::string blockNumber = generateSplitBlockNumber(trans, o); /**< The number of blocks the loop will be
+                                                                   * splitted into */
 
-    std::string splitCondition = "petabricks::split_condition<"+jalib::XToString(dimensions())+", "+jalib::XToString(blockNumber)+">("SPLIT_CHUNK_SIZE","COORD_BEGIN_STR","COORD_END_STR")";
+    std::string splitCondition = "petabricks::split_condition<"+jalib::XToString(dimensions())+">("SPLIT_CHUNK_SIZE","+blockNumber+","COORD_BEGIN_STR","COORD_END_STR")";
     o.beginIf(splitCondition);
 
-    iterdef.genSplitCode(o, trans, *this, flavor, blockNumber, SpatialCallTypes::WORKSTEALING_PARTIAL);
+    generateSplitSwitch(trans, o, iterdef, flavor, SpatialCallTypes::WORKSTEALING_PARTIAL);
     // return written in get split code
     o.elseIf();
   }
@@ -1607,9 +1607,7 @@ void petabricks::UserRule::generatePartialTrampCode(Transform& trans, CodeGenera
       o.write("IndexT " + i->name() + " = metadata->" + i->name() + ";");
     }
 
-    iterdef.genLoopBegin(o);
-    generateTrampCellCodeSimple( trans, o, RuleFlavor::WORKSTEALING_PARTIAL );
-    iterdef.genLoopEnd(o);
+    generateTrampCellLoop( trans, o, iterdef, RuleFlavor::WORKSTEALING_PARTIAL );
   }
 
 #ifdef HAVE_OPENCL
@@ -2547,6 +2545,121 @@ void petabricks::UserRule::generateTrampCellCodeSimple(Transform& trans, CodeGen
   }
 }
 
+std::string petabricks::UserRule::generateSplitBlockNumber(Transform& trans, CodeGenerator& o){
+  //the learned heuristic only seeds the tunable, the autotuner searches the rest
+  Heuristic blockNumberHeur = HeuristicManager::instance().getHeuristic("UserRule_blockNumber");
+  blockNumberHeur.setMin(2);
+  blockNumberHeur.setMax(maxBlockNumber());
+  int initial = (int)blockNumberHeur.eval(ValueMap());
+  std::string name = blocknumbername(trans);
+  o.createTunable(true, "system.size.blocknumber", name, initial, 2, maxBlockNumber());
+  return name;
+}
+
+void petabricks::UserRule::generateSplitSwitch(Transform& trans, CodeGenerator& o, IterationDefinition& iterdef, RuleFlavor flavor, SpatialCallType spatialCallType){
+  if(iterdef.canBisect() && spatialCallType != SpatialCallTypes::DISTRIBUTED
+     && (flavor == RuleFlavor::SEQUENTIAL || flavor == RuleFlavor::WORKSTEALING)){
+    //without self dependencies the autotuner may pick recursive bisection instead
+    std::string bisect = bisectname(trans);
+    o.createTunable(true, "system.flag.bisect", bisect, 0, 0, 1);
+    o.beginIf(bisect);
+    iterdef.genBisectCode(o, trans, *this, flavor, spatialCallType);
+    o.endIf();
+  }
+  if(iterdef.canWavefront() && flavor == RuleFlavor::WORKSTEALING
+     && spatialCallType == SpatialCallTypes::NORMAL){
+    //self dependent rules may run tiles on a diagonal in parallel instead
+    std::string tilesize = wavefrontname(trans);
+    o.createTunable(true, "system.size.tile", tilesize, 0, 0, 4096);
+    o.beginIf("petabricks::wavefront_condition<"+jalib::XToString(dimensions())+">("+tilesize+", "COORD_BEGIN_STR", "COORD_END_STR")");
+    iterdef.genWavefrontCode(o, trampcodename(trans)+"_"+flavor.str(), tilesize);
+    o.endIf();
+  }
+  //GroupedDynamicTask needs a compile time size, so we emit the split code
+  //for every fan-out the tunable may select
+  o.beginSwitch(blocknumbername(trans));
+  for(int n=2; n<=maxBlockNumber(); ++n){
+    o.beginCase(n);
+    iterdef.genSplitCode(o, trans, *this, flavor, n, spatialCallType);
+    o.endCase();
+  }
+  o.write("default: JASSERT(false)("+blocknumbername(trans)+");");
+  o.endSwitch();
+}
+
+void petabricks::UserRule::generateTrampCellLoop(Transform& trans, CodeGenerator& o, IterationDefinition& iterdef, RuleFlavor flavor){
+  if(pbcConfig::thePerfCounters){
+    std::string cells = "(uint64_t)1";
+    for(int i=0; i<iterdef.dimensions(); ++i){
+      std::string extent = "(" + iterdef.end()[i]->toString() + "-" + iterdef.begin()[i]->toString() + ")";
+      //one cell per iteration, so a strided loop counts ceil(extent/step)
+      if(!iterdef.isSingleCall() && iterdef.step()[i]->toString() != "1"){
+        std::string step = "(" + iterdef.step()[i]->toString() + ")";
+        extent = "((" + extent + "+" + step + "-1)/" + step + ")";
+      }
+      cells += "*" + extent;
+    }
+    o.beginPerfScope(trampcodename(trans)+"_"+flavor.str(), "RULE", cells, RuleFlavor::SEQUENTIAL != flavor);
+  }
+  bool callsInline = RuleFlavor::SEQUENTIAL == flavor
+                  || RuleFlavor::WORKSTEALING_PARTIAL == flavor
+                  || (RuleFlavor::WORKSTEALING == flavor && !isRecursive());
+  //the unrolled copies cost code size in every rule, so they are only
+  //emitted when the learned heuristic asks for them (off by default)
+  int maxUnroll = 0;
+  if(callsInline && iterdef.canUnrollInner()){
+    Heuristic unrollHeur = HeuristicManager::instance().getHeuristic("UserRule_unrollLimit");
+    unrollHeur.setMin(0);
+    unrollHeur.setMax(MAX_UNROLL);
+    maxUnroll = (int)unrollHeur.eval(ValueMap());
+  }
+  bool unrolled = maxUnroll > 0;
+  if(unrolled){
+    //below the tuned extent the inner loop is written out once per extent,
+    //so small base cases run without loop overhead or runtime trip counts
+    std::string unroll = unrollname(trans);
+    o.createTunable(true, "system.size.unroll", unroll, 0, 0, maxUnroll);
+    o.beginIf(iterdef.innerExtent()+" <= "+unroll);
+    iterdef.genOuterLoopBegin(o);
+    o.beginSwitch(iterdef.innerExtent());
+    for(int n=1; n<=maxUnroll; ++n){
+      o.beginCase(n);
+      for(int k=0; k<n; ++k){
+        o.write("{");
+        iterdef.genUnrolledIter(o, k);
+        generateTrampCellCodeSimple( trans, o, flavor );
+        o.write("}");
+      }
+      o.endCase();
+    }
+    o.endSwitch();
+    iterdef.genOuterLoopEnd(o);
+    o.elseIf();
+  }
+  if(callsInline && iterdef.canTile()){
+    //tile size of 0 disables tiling, the autotuner picks the blocking factor
+    std::string tilesize = tilesizename(trans);
+    o.createTunable(true, "system.size.tile", tilesize, 0, 0, 4096);
+    o.beginIf(tilesize+" > 0");
+    iterdef.genTiledLoopBegin(o, tilesize);
+    generateTrampCellCodeSimple( trans, o, flavor );
+    iterdef.genTiledLoopEnd(o);
+    o.elseIf();
+    iterdef.genLoopBegin(o);
+    generateTrampCellCodeSimple( trans, o, flavor );
+    iterdef.genLoopEnd(o);
+    o.endIf();
+  }else{
+    iterdef.genLoopBegin(o);
+    generateTrampCellCodeSimple( trans, o, flavor );
+    iterdef.genLoopEnd(o);
+  }
+  if(unrolled)
+    o.endIf();
+  if(pbcConfig::thePerfCounters)
+    o.endPerfScope();
+}
+
  void petabricks::UserRule::generateToLocalRegionCode(Transform& trans, CodeGenerator& o, RuleFlavor flavor, IterationDefinition& iterdef, bool generateWorkStealingRegion, bool generateIterTrampMetadata, bool generatePartialTrampMetadata) {
   std::vector<std::string> args;
 
@@ -2593,15 +2706,9 @@ void petabricks::UserRule::generateTrampCellCodeSimple(Transform& trans, CodeGen
       o.decIndent();
       o.write("}");
 
-      o.write(matrix->typeName(flavor, isConst) + " " + matrix->name() + scratchSuffix + "(remote_" + matrix->name() + ".size());");
-      o.write(matrix->name() + scratchSuffix + ".allocDataLocal();");
-
-      if (matrix->type() == MatrixDef::T_FROM) {
-        o.write("remote_" + matrix->name() + ".localCopy(" + matrix->name() + scratchSuffix + ", true);");
-
-      } else {
-        o.write("remote_" + matrix->name() + ".localCopy(" + matrix->name() + scratchSuffix + ", false);");
-      }
+      // aliases the data instead of copying it when it is all on this node
+      o.write(matrix->typeName(flavor, isConst) + " " + matrix->name() + scratchSuffix
+              + " = remote_" + matrix->name() + ".localScratch(" + (isConst ? "true" : "false") + ");");
     } else {
       o.write(matrix->typeName(flavor, isConst) + " remote_" + matrix->name() + " = " + i->first + ";");
       if (isConst) {
@@ -2844,6 +2951,40 @@ std::string petabricks::UserRule::partialtrampcodename(Transform& trans) const {
 std::string petabricks::UserRule::partialtrampmetadataname(Transform& trans) const {
   return trampcodename(trans) + "_partial_metadata";
 }
+std::string petabricks::UserRule::tilesizename(Transform& trans) const {
+  return implcodename(trans) + "_tilesize";
+}
+
+std::string petabricks::UserRule::blocknumbername(Transform& trans) const {
+  return implcodename(trans) + "_blocknumber";
+}
+
+std::string petabricks::UserRule::bisectname(Transform& trans) const {
+  return implcodename(trans) + "_bisect";
+}
+
+std::string petabricks::UserRule::wavefrontname(Transform& trans) const {
+  return implcodename(trans) + "_wavefront";
+}
+
+std::string petabricks::UserRule::unrollname(Transform& trans) const {
+  return implcodename(trans) + "_unroll";
+}
+
+int petabricks::UserRule::maxBlockNumber() const {
+  //every candidate fan-out n emits n^d task spawns, so only go above 2
+  //while that stays within 16 tasks; the minimum fan-out of 2 is always
+  //generated and spawns 2^d tasks, more than 16 for 5 or more dimensions
+  int n=2;
+  for(;n<8; ++n){
+    int tasks=1;
+    for(int d=0; d<dimensions(); ++d)
+      tasks*=n+1;
+    if(tasks>16)
+      break;
+  }
+  return n;
+}
 
 size_t petabricks::UserRule::duplicateCount() const {
   int c = 1;
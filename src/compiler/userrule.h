@@ -112,6 +112,9 @@ public:
   void generatePartialTrampCode(Transform& trans, CodeGenerator& o, RuleFlavor flavor);
 
   void generateTrampCellCodeSimple(Transform& trans, CodeGenerator& o, RuleFlavor flavor);
+  void generateTrampCellLoop(Transform& trans, CodeGenerator& o, IterationDefinition& iterdef, RuleFlavor flavor);
+  std::string generateSplitBlockNumber(Transform& trans, CodeGenerator& o);
+  void generateSplitSwitch(Transform& trans, CodeGenerator& o, IterationDefinition& iterdef, RuleFlavor flavor, SpatialCallType spatialCallType);
   void generateToLocalRegionCode(Transform& trans, CodeGenerator& o, RuleFlavor flavor, IterationDefinition& iterdef, bool generateWorkStealingRegion, bool generateIterTrampMetadata, bool generatePartialTrampMetadata);
 
   void generateUseOnCpu(CodeGenerator& o);
@@ -165,6 +168,15 @@ public:
   std::string itertrampmetadataname(Transform& trans) const;
   std::string partialtrampcodename(Transform& trans) const;
   std::string partialtrampmetadataname(Transform& trans) const;
+  std::string tilesizename(Transform& trans) const;
+  std::string blocknumbername(Transform& trans) const;
+  std::string bisectname(Transform& trans) const;
+  std::string wavefrontname(Transform& trans) const;
+  std::string unrollname(Transform& trans) const;
+
+  ///
+  /// Largest split fan-out (per dimension) we generate split code for
+  int maxBlockNumber() const;
 
   bool isReturnStyle() const { return _flags.isReturnStyle; }
 
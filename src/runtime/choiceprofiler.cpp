@@ -0,0 +1,162 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "choiceprofiler.h"
+
+#include "common/jassert.h"
+#include "common/jmutex.h"
+
+#include <fstream>
+#include <map>
+#include <vector>
+
+bool petabricks::ChoiceProfiler::_enabled = false;
+
+namespace { //file local
+  typedef petabricks::ChoiceSite ChoiceSite;
+
+  std::string theFilename;
+
+  jalib::JMutex theLock;
+  std::vector<const ChoiceSite*> theSites;
+
+  /**
+   * (site, choice, floor(log2(n)))
+   */
+  struct Key {
+    int site;
+    int choice;
+    int sizeLog2;
+    bool operator< (const Key& that) const {
+      if(site != that.site) return site < that.site;
+      if(choice != that.choice) return choice < that.choice;
+      return sizeLog2 < that.sizeLog2;
+    }
+  };
+
+  struct Totals {
+    long calls;
+    long timedCalls;
+    double seconds;
+    double selfSeconds;
+    long minN;
+    long maxN;
+    Totals() : calls(0), timedCalls(0), seconds(0), selfSeconds(0), minN(-1), maxN(-1) {}
+
+    void add(const Totals& that){
+      calls += that.calls;
+      timedCalls += that.timedCalls;
+      seconds += that.seconds;
+      selfSeconds += that.selfSeconds;
+      if(minN<0 || (that.minN>=0 && that.minN<minN)) minN = that.minN;
+      if(that.maxN>maxN) maxN = that.maxN;
+    }
+  };
+
+  typedef std::map<Key, Totals> Table;
+
+  ///
+  /// Only the owning thread writes to its table, dump() reads them all at exit
+  std::vector<Table*> theTables;
+
+  Table& myTable(){
+    static __thread Table* t = NULL;
+    if(t==NULL){
+      t = new Table();
+      JLOCKSCOPE(theLock);
+      theTables.push_back(t);
+    }
+    return *t;
+  }
+
+  int floorLog2(long n){
+    int lg = 0;
+    while(n > 1){
+      n >>= 1;
+      ++lg;
+    }
+    return lg;
+  }
+}
+
+petabricks::ChoiceSite::ChoiceSite(const char* name)
+  : _name(name)
+{
+  JLOCKSCOPE(theLock);
+  _id = theSites.size();
+  theSites.push_back(this);
+}
+
+petabricks::ChoiceProfileScope*& petabricks::ChoiceProfileScope::current(){
+  static __thread ChoiceProfileScope* c = NULL;
+  return c;
+}
+
+void petabricks::ChoiceProfiler::enable(const std::string& filename){
+  theFilename = filename;
+  _enabled = true;
+}
+
+void petabricks::ChoiceProfiler::add(const ChoiceSite& site, long n, int choice, double seconds, double selfSeconds, bool timed){
+  Key k;
+  k.site = site.id();
+  k.choice = choice;
+  k.sizeLog2 = floorLog2(n);
+  Totals& t = myTable()[k];
+  t.calls++;
+  if(timed){
+    t.timedCalls++;
+    t.seconds += seconds;
+    t.selfSeconds += selfSeconds;
+  }
+  if(t.minN<0 || n<t.minN) t.minN = n;
+  if(n>t.maxN) t.maxN = n;
+}
+
+void petabricks::ChoiceProfiler::dump(){
+  if(!_enabled)
+    return;
+  JLOCKSCOPE(theLock);
+  Table total;
+  for(size_t i=0; i<theTables.size(); ++i)
+    for(Table::const_iterator t=theTables[i]->begin(); t!=theTables[i]->end(); ++t)
+      total[t->first].add(t->second);
+
+  std::ofstream o(theFilename.c_str());
+  JASSERT(o.is_open())(theFilename).Text("failed to open --choiceprofile output");
+  o << "site,choice,size_log2,calls,timed_calls,seconds,self_seconds,min_n,max_n\n";
+  for(Table::const_iterator t=total.begin(); t!=total.end(); ++t){
+    o << theSites[t->first.site]->name() << ','
+      << t->first.choice << ','
+      << t->first.sizeLog2 << ','
+      << t->second.calls << ','
+      << t->second.timedCalls << ','
+      << t->second.seconds << ','
+      << t->second.selfSeconds << ','
+      << t->second.minN << ','
+      << t->second.maxN << '\n';
+  }
+}
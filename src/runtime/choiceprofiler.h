@@ -0,0 +1,125 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PETABRICKSCHOICEPROFILER_H
+#define PETABRICKSCHOICEPROFILER_H
+
+#include "onlinetuner.h"
+
+#include "common/jtimer.h"
+
+#include <string>
+
+namespace petabricks {
+
+/**
+ * The schedule selector of one transform, declared as a function-local
+ * static by generated code; name matches the algchoice prefix in the config
+ */
+class ChoiceSite {
+public:
+  ChoiceSite(const char* name);
+
+  int id() const { return _id; }
+  const char* name() const { return _name; }
+private:
+  const char* _name;
+  int _id;
+};
+
+/**
+ * Records which choice each selector made, at which input size and how long
+ * the chosen schedule took (--choiceprofile)
+ */
+class ChoiceProfiler {
+public:
+  ///
+  /// Start recording and write the table to filename at exit
+  static void enable(const std::string& filename);
+  static bool enabled() { return _enabled; }
+
+  ///
+  /// Count a decision whose work runs asynchronously (workstealing flavor)
+  static void record(const ChoiceSite& site, long n, int choice){
+    if(_enabled) add(site, n, choice, 0, 0, false);
+  }
+
+  ///
+  /// Write one csv row per (site, choice, power of two size range)
+  static void dump();
+
+  static void add(const ChoiceSite& site, long n, int choice, double seconds, double selfSeconds, bool timed);
+private:
+  static bool _enabled;
+};
+
+/**
+ * Times one call of a sequential transform from its selector decision to
+ * the return, time spent in nested ChoiceProfileScopes on the same thread is
+ * subtracted from the self time.  Feeds both --choiceprofile and
+ * --online-tune.
+ */
+class ChoiceProfileScope {
+public:
+  ChoiceProfileScope(const ChoiceSite& site, long n, int choice, int defaultChoice)
+    : _site(site), _n(n), _choice(choice), _defaultChoice(defaultChoice)
+    , _active(ChoiceProfiler::enabled() || OnlineTuner::enabled())
+    , _parent(NULL), _childSeconds(0), _start(jalib::JTime::null())
+  {
+    if(_active){
+      _parent = current();
+      current() = this;
+      _start = jalib::JTime::now();
+    }
+  }
+
+  ~ChoiceProfileScope(){
+    if(_active){
+      double seconds = jalib::JTime::now()-_start;
+      current() = _parent;
+      if(_parent != NULL)
+        _parent->_childSeconds += seconds;
+      if(ChoiceProfiler::enabled())
+        ChoiceProfiler::add(_site, _n, _choice, seconds, seconds-_childSeconds, true);
+      OnlineTuner::observe(_site, _n, _choice, _defaultChoice, seconds);
+    }
+  }
+private:
+  static ChoiceProfileScope*& current();
+
+  const ChoiceSite& _site;
+  long _n;
+  int _choice;
+  int _defaultChoice;
+  bool _active;
+  ChoiceProfileScope* _parent;
+  double _childSeconds;
+  jalib::JTime _start;
+};
+
+}
+
+#endif
@@ -0,0 +1,98 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "counterrandom.h"
+
+#include "dynamicscheduler.h"
+#include "dynamictask.h"
+
+#include "common/jasm.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace { //file local
+  ///
+  /// Elements per task, fixed so the split does not depend on thread count
+  const size_t theChunkSize = 64*1024;
+
+  uint64_t theSeed = 0x5EED5EED5EED5EEDULL;
+  jalib::AtomicT theNextStream = 0;
+
+  /**
+   * Fills one chunk of a buffer
+   */
+  class FillTask : public petabricks::DynamicTask {
+  public:
+    typedef petabricks::CounterRandom::FillFn FillFn;
+    FillTask(const petabricks::CounterRandom& r, void* data, size_t begin, size_t end,
+             double min, double max, FillFn fn)
+      : _rand(r), _data(data), _begin(begin), _end(end), _min(min), _max(max), _fn(fn)
+    {}
+    petabricks::DynamicTaskPtr run(){
+      _fn(_rand, _data, _begin, _end, _min, _max);
+      return 0;
+    }
+  private:
+    petabricks::CounterRandom _rand;
+    void* _data;
+    size_t _begin;
+    size_t _end;
+    double _min;
+    double _max;
+    FillFn _fn;
+  };
+}
+
+void petabricks::CounterRandom::setSeed(uint64_t seed){
+  theSeed = seed;
+}
+
+uint64_t petabricks::CounterRandom::seed(){
+  return theSeed;
+}
+
+uint64_t petabricks::CounterRandom::nextStream(){
+  return (uint64_t) jalib::atomicIncrementReturn(&theNextStream);
+}
+
+void petabricks::CounterRandom::parallelFillImpl(void* data, size_t n, double min, double max, FillFn fn) const {
+  int threads = DynamicScheduler::cpuScheduler().numThreads();
+  if(threads<=1 || n<=theChunkSize || WorkerThread::self()==NULL){
+    fn(*this, data, 0, n, min, max);
+    return;
+  }
+  std::vector<DynamicTaskPtr> tasks;
+  for(size_t begin=theChunkSize; begin<n; begin+=theChunkSize){
+    DynamicTaskPtr t = new FillTask(*this, data, begin, std::min(n, begin+theChunkSize), min, max, fn);
+    t->enqueue();
+    tasks.push_back(t);
+  }
+  //first chunk on this thread while the workers take the rest
+  fn(*this, data, 0, theChunkSize, min, max);
+  for(size_t i=0; i<tasks.size(); ++i)
+    tasks[i]->waitUntilComplete();
+}
@@ -0,0 +1,117 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PETABRICKSCOUNTERRANDOM_H
+#define PETABRICKSCOUNTERRANDOM_H
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace petabricks {
+
+/**
+ * Counter based random number generator: element i of a stream is a hash
+ * of (seed, stream, i), so any chunk of a buffer can be generated
+ * independently and the result does not depend on how many threads
+ * generated it
+ */
+class CounterRandom {
+public:
+  ///
+  /// The seed shared by all streams, fixed unless the runtime reseeds it
+  static void setSeed(uint64_t seed);
+  static uint64_t seed();
+
+  ///
+  /// Reserve a new stream id, ids are handed out in call order so
+  /// sequential callers see the same streams on every run
+  static uint64_t nextStream();
+
+  ///
+  /// A generator for a freshly reserved stream
+  CounterRandom() : _seed(seed()), _stream(nextStream()) { init(); }
+
+  ///
+  /// A generator for a given stream (from another node)
+  CounterRandom(uint64_t seed, uint64_t stream) : _seed(seed), _stream(stream) { init(); }
+
+  uint64_t seedValue() const { return _seed; }
+  uint64_t streamValue() const { return _stream; }
+
+  ///
+  /// 64 random bits for element i
+  uint64_t bits(uint64_t i) const { return mix(_key + i*0x9E3779B97F4A7C15ULL); }
+
+  ///
+  /// Element i as a double in [0, 1)
+  double uniform(uint64_t i) const {
+    return (double)(bits(i) >> 11) * (1.0/9007199254740992.0);
+  }
+
+  ///
+  /// Fill data[begin, end) with elements begin..end of the stream scaled to
+  /// [min, max), the loop has no cross-iteration state so it vectorizes
+  template<typename T>
+  void fill(T* data, size_t begin, size_t end, double min, double max) const {
+    double scale = max-min;
+    for(size_t i=begin; i<end; ++i)
+      data[i] = (T)(min + scale*uniform(i));
+  }
+
+  ///
+  /// Fill data[0, n) on the worker pool, same result as fill(data, 0, n, ...)
+  template<typename T>
+  void parallelFill(T* data, size_t n, double min, double max) const {
+    parallelFillImpl(data, n, min, max, &fillThunk<T>);
+  }
+
+  typedef void (*FillFn)(const CounterRandom&, void*, size_t, size_t, double, double);
+private:
+  template<typename T>
+  static void fillThunk(const CounterRandom& r, void* data, size_t begin, size_t end, double min, double max){
+    r.fill(static_cast<T*>(data), begin, end, min, max);
+  }
+
+  void parallelFillImpl(void* data, size_t n, double min, double max, FillFn fn) const;
+
+  void init() { _key = mix(_seed ^ mix(_stream + 0x632BE59BD9B4E019ULL)); }
+
+  ///
+  /// splitmix64 finalizer
+  static uint64_t mix(uint64_t z){
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+private:
+  uint64_t _seed;
+  uint64_t _stream;
+  uint64_t _key;
+};
+
+}
+
+#endif
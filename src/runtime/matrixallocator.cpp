@@ -0,0 +1,189 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "matrixallocator.h"
+
+#include "dynamicscheduler.h"
+#include "dynamictask.h"
+
+#include "common/jassert.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+namespace { //file local
+  typedef petabricks::MatrixAllocator MatrixAllocator;
+
+  const size_t theHugePageSize = 2*1024*1024;
+  const size_t theTouchStride  = 4096;
+  const int    MPOL_INTERLEAVE_ = 3; //from <numaif.h>, which needs libnuma
+
+  MatrixAllocator::Policy thePolicy = MatrixAllocator::POLICY_HEAP;
+
+  jalib::AtomicT theMapCount = 0;
+  jalib::AtomicT theMapMB = 0;
+  jalib::AtomicT theFallbacks = 0;
+
+  size_t roundUp(size_t n, size_t align){
+    return (n+align-1)/align*align;
+  }
+
+  ///
+  /// mmap length bytes aligned to theHugePageSize, or NULL
+  void* mapAligned(size_t length){
+    size_t padded = length + theHugePageSize;
+    char* p = (char*)mmap(NULL, padded, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(p == MAP_FAILED)
+      return NULL;
+    char* aligned = (char*)roundUp((size_t)p, theHugePageSize);
+    if(aligned > p)
+      munmap(p, aligned-p);
+    munmap(aligned+length, (p+padded)-(aligned+length));
+    return aligned;
+  }
+
+  ///
+  /// Spread the pages of a buffer over every node we may allocate on
+  bool interleave(void* p, size_t length){
+#if defined(__linux__) && defined(SYS_mbind)
+    unsigned long nodes = ~0UL;
+    return syscall(SYS_mbind, p, length, MPOL_INTERLEAVE_, &nodes, sizeof(nodes)*8, 0) == 0;
+#else
+    (void)p; (void)length;
+    return false;
+#endif
+  }
+
+  /**
+   * Writes one byte per page of a range so the page is placed on the node of
+   * the worker that runs this task
+   */
+  class FirstTouchTask : public petabricks::DynamicTask {
+  public:
+    FirstTouchTask(char* begin, char* end) : _begin(begin), _end(end) {}
+    petabricks::DynamicTaskPtr run(){
+      for(volatile char* i=_begin; i<_end; i+=theTouchStride)
+        *i = 0;
+      return 0;
+    }
+  private:
+    char* _begin;
+    char* _end;
+  };
+
+  void firstTouch(void* p, size_t length){
+    int threads = petabricks::DynamicScheduler::cpuScheduler().numThreads();
+    size_t pages = length/theHugePageSize;
+    size_t pieces = std::min<size_t>(pages, 4*threads);
+    if(threads<=1 || pieces<=1 || petabricks::WorkerThread::self()==NULL){
+      FirstTouchTask((char*)p, (char*)p+length).run();
+      return;
+    }
+    std::vector<petabricks::DynamicTaskPtr> tasks;
+    for(size_t i=0; i<pieces; ++i){
+      char* begin = (char*)p + pages*i/pieces*theHugePageSize;
+      char* end   = (char*)p + pages*(i+1)/pieces*theHugePageSize;
+      if(i+1==pieces) end = (char*)p+length;
+      petabricks::DynamicTaskPtr t = new FirstTouchTask(begin, end);
+      t->enqueue();
+      tasks.push_back(t);
+    }
+    for(size_t i=0; i<tasks.size(); ++i)
+      tasks[i]->waitUntilComplete();
+  }
+}
+
+bool petabricks::MatrixAllocator::setPolicy(const std::string& name){
+  for(int p=POLICY_HEAP; p<=POLICY_INTERLEAVE; ++p){
+    if(name == policyName((Policy)p)){
+      thePolicy = (Policy)p;
+      return true;
+    }
+  }
+  return false;
+}
+
+petabricks::MatrixAllocator::Policy petabricks::MatrixAllocator::policy(){
+  return thePolicy;
+}
+
+const char* petabricks::MatrixAllocator::policyName(Policy p){
+  switch(p){
+    case POLICY_HEAP:       return "heap";
+    case POLICY_THP:        return "thp";
+    case POLICY_HUGETLB:    return "hugetlb";
+    case POLICY_FIRSTTOUCH: return "firsttouch";
+    case POLICY_INTERLEAVE: return "interleave";
+  }
+  return "unknown";
+}
+
+void* petabricks::MatrixAllocator::map(size_t bytes, size_t& length){
+  if(thePolicy == POLICY_HEAP || bytes < theHugePageSize)
+    return NULL;
+  length = roundUp(bytes, theHugePageSize);
+  void* p = NULL;
+#ifdef MAP_HUGETLB
+  if(thePolicy == POLICY_HUGETLB){
+    p = mmap(NULL, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+    if(p == MAP_FAILED){
+      //hugetlb pool is empty or not configured
+      p = NULL;
+      jalib::atomicIncrement(&theFallbacks);
+    }
+  }
+#endif
+  if(p == NULL){
+    p = mapAligned(length);
+    if(p == NULL){
+      jalib::atomicIncrement(&theFallbacks);
+      return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(p, length, MADV_HUGEPAGE);
+#endif
+  }
+  if(thePolicy == POLICY_INTERLEAVE && !interleave(p, length))
+    jalib::atomicIncrement(&theFallbacks);
+  if(thePolicy == POLICY_FIRSTTOUCH)
+    firstTouch(p, length);
+  jalib::atomicIncrement(&theMapCount);
+  jalib::atomicAdd(&theMapMB, (long)(length/(1024*1024)));
+  return p;
+}
+
+void petabricks::MatrixAllocator::dumpStats(std::ostream& o){
+  o << "<allocation policy=\"" << policyName(thePolicy) << "\""
+    << " mapped=\"" << theMapCount << "\""
+    << " mapped_mb=\"" << theMapMB << "\""
+    << " fallbacks=\"" << theFallbacks << "\" />";
+}
@@ -0,0 +1,73 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PETABRICKSMATRIXALLOCATOR_H
+#define PETABRICKSMATRIXALLOCATOR_H
+
+#include "common/jasm.h"
+
+#include <iostream>
+#include <string>
+
+namespace petabricks {
+
+/**
+ * Picks where the buffers behind MatrixStorage come from, the policy is set
+ * once per run (--alloc-policy) and buffers smaller than a huge page always
+ * come from the heap
+ */
+class MatrixAllocator {
+public:
+  enum Policy {
+    POLICY_HEAP,       ///< plain new[], pages placed by whoever touches them
+    POLICY_THP,        ///< 2MB aligned mmap with madvise(MADV_HUGEPAGE)
+    POLICY_HUGETLB,    ///< explicit 2MB pages from the hugetlb pool (THP if empty)
+    POLICY_FIRSTTOUCH, ///< THP, pages first touched in parallel by the worker pool
+    POLICY_INTERLEAVE  ///< THP, pages interleaved across all NUMA nodes
+  };
+
+  ///
+  /// Set the policy by name, false if the name is unknown
+  static bool setPolicy(const std::string& name);
+
+  static Policy policy();
+
+  static const char* policyName(Policy p);
+
+  ///
+  /// Map a buffer of (at least) bytes under the current policy, the buffer
+  /// must be released with munmap(result, length).  Returns NULL if the
+  /// buffer should come from the heap instead.
+  static void* map(size_t bytes, size_t& length);
+
+  ///
+  /// Write the policy and allocation counters as an xml element
+  static void dumpStats(std::ostream& o);
+};
+
+}
+
+#endif
@@ -30,11 +30,179 @@
 # include "config.h"
 #endif
 
-void matrixreaderset_in (FILE *  in_str );
-int matrixreaderlex(petabricks::MatrixReaderScratch&);
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 
-petabricks::MatrixIOGeneral::MatrixIOGeneral(FILE* file) : _fd(file) {}
+namespace {
+  typedef MATRIX_ELEMENT_T ElementT;
+
+  //bytes of text each parallel piece parses per chunk
+  const size_t theTextPieceBytes = 1<<20;
+
+  const double thePowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  inline bool isSpace(int c) {
+    return c==' ' || c=='\t' || c=='\r' || c=='\n';
+  }
+
+  inline bool isDigit(int c) {
+    return c>='0' && c<='9';
+  }
+
+  ///
+  /// Parse the element in [begin, end).  Mantissas of up to 15 digits with
+  /// small exponents are exactly representable, so the result of one multiply
+  /// or divide is correctly rounded; everything else goes through strtod
+  double parseElement(const char* begin, const char* end) {
+    const char* p = begin;
+    bool negative = false;
+    if(p<end && (*p=='-' || *p=='+'))
+      negative = (*p++=='-');
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+    for(; p<end && isDigit(*p); ++p, any=true){
+      mantissa = mantissa*10 + (*p-'0');
+      if(mantissa!=0) ++digits;
+    }
+    if(p<end && *p=='.'){
+      for(++p; p<end && isDigit(*p); ++p, any=true){
+        mantissa = mantissa*10 + (*p-'0');
+        if(mantissa!=0) ++digits;
+        --exponent;
+      }
+    }
+    if(any && p<end && (*p=='e' || *p=='E')){
+      ++p;
+      bool negativeExponent = false;
+      if(p<end && (*p=='-' || *p=='+'))
+        negativeExponent = (*p++=='-');
+      int e = 0;
+      any = false;
+      for(; p<end && isDigit(*p); ++p, any=true)
+        if(e<10000) e = e*10 + (*p-'0');
+      exponent += negativeExponent ? -e : e;
+    }
+    if(any && p==end && digits<=15 && exponent>=-22 && exponent<=22){
+      double v = (double)mantissa;
+      v = exponent<0 ? v/thePowersOfTen[-exponent] : v*thePowersOfTen[exponent];
+      return negative ? -v : v;
+    }
+    //slow path: long mantissas, large exponents, inf and nan
+    std::string token(begin, end);
+    char* stop = NULL;
+    double v = strtod(token.c_str(), &stop);
+    JASSERT(!token.empty() && stop==token.c_str()+token.size())(token).Text("Unhandled input");
+    return v;
+  }
+
+  /**
+   * A buffer of whitespace separated elements, split at whitespace into
+   * pieces which are first counted and then parsed in parallel
+   */
+  class MatrixTextChunk {
+  public:
+    MatrixTextChunk(const char* buf, size_t len, int pieces)
+      : _buf(buf), _bounds(pieces+1, len), _counts(pieces, 0), _offsets(pieces, 0),
+        _limits(pieces, 0), _out(NULL), _cut(-1), _consumed(len)
+    {
+      _bounds[0] = 0;
+      for(int i=1; i<pieces; ++i){
+        size_t pos = std::max(_bounds[i-1], len*i/pieces);
+        while(pos<len && !isSpace(buf[pos])) ++pos;
+        _bounds[i] = pos;
+      }
+    }
+
+    ///
+    /// Count the elements in one piece
+    void countPiece(int piece){
+      const char* p   = _buf+_bounds[piece];
+      const char* end = _buf+_bounds[piece+1];
+      size_t n = 0;
+      bool inToken = false;
+      for(; p<end; ++p){
+        bool space = isSpace(*p);
+        if(!space && !inToken) ++n;
+        inToken = !space;
+      }
+      _counts[piece] = n;
+    }
+
+    ///
+    /// Assign each piece its place in out, taking at most max elements in
+    /// total, returns the number taken
+    size_t assign(ElementT* out, size_t max){
+      _out = out;
+      size_t total = 0;
+      for(size_t i=0; i<_counts.size(); ++i){
+        _offsets[i] = total;
+        _limits[i]  = std::min(_counts[i], max-total);
+        total += _limits[i];
+        if(_cut<0 && _limits[i]<_counts[i])
+          _cut = i;
+      }
+      return total;
+    }
+
+    ///
+    /// Parse the assigned elements of one piece
+    void parsePiece(int piece){
+      const char* p   = _buf+_bounds[piece];
+      const char* end = _buf+_bounds[piece+1];
+      ElementT* out = _out+_offsets[piece];
+      for(size_t n=0; n<_limits[piece]; ++n){
+        while(p<end && isSpace(*p)) ++p;
+        const char* token = p;
+        while(p<end && !isSpace(*p)) ++p;
+        *out++ = parseElement(token, p);
+      }
+      if(piece==_cut)
+        _consumed = p-_buf;
+    }
+
+    ///
+    /// Bytes of the buffer up to the end of the last parsed element
+    size_t consumed() const { return _consumed; }
+
+  private:
+    const char* _buf;
+    std::vector<size_t> _bounds;
+    std::vector<size_t> _counts;
+    std::vector<size_t> _offsets;
+    std::vector<size_t> _limits;
+    ElementT* _out;
+    int _cut;
+    size_t _consumed;
+  };
+
+  uint32_t byteswap32(uint32_t v) {
+    return (v>>24) | ((v>>8)&0xff00) | ((v<<8)&0xff0000) | (v<<24);
+  }
+  uint64_t byteswap64(uint64_t v) {
+    return (uint64_t(byteswap32(uint32_t(v))) << 32) | byteswap32(uint32_t(v>>32));
+  }
+  void byteswapInPlace(char* p, size_t n) {
+    for(size_t i=0; i<n/2; ++i)
+      std::swap(p[i], p[n-1-i]);
+  }
+  bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size()>=suffix.size() && s.compare(s.size()-suffix.size(), suffix.size(), suffix)==0;
+  }
+}
+
+petabricks::MatrixIOGeneral::MatrixIOGeneral(FILE* file) : _fd(file), _binary(false) {}
 petabricks::MatrixIOGeneral::MatrixIOGeneral(const char* filename, const char* mode)
+  : _binary(endsWith(filename, ".pbmat"))
 {
   JTRACE("MatrixIO")(filename)(mode);
   if(std::string("-")==filename)
@@ -49,15 +217,209 @@ petabricks::MatrixIOGeneral::MatrixIOGeneral(const char* filename, const char* m
 
 void petabricks::MatrixIOGeneral::_read(MatrixReaderScratch& o){
   if(_fd == stdout) _fd = stdin;
-  matrixreaderset_in(_fd);
-  matrixreaderlex(o);
-  matrixreaderset_in(NULL);
+  //the binary magic can not start a text matrix, so one char decides
+  int c = getc(_fd);
+  if(c != EOF) ungetc(c, _fd);
+  if(c == (unsigned char)MatrixBinaryHeader::MAGIC()[0]){
+    _readBinary(o);
+  }else{
+    _readText(o);
+  }
   JASSERT(o.dimensions>=0 && o.dimensions < MAX_DIMENSIONS)
       (o.dimensions).Text("failed to read input matrix, invalid size");
   JASSERT(o.storage).Text("failed to read input matrix");
   JASSERT(o.remaining==0)(o.remaining).Text("failed to read input matrix");
 }
 
+int petabricks::MatrixIOGeneral::_textPieces(){
+  int threads = DynamicScheduler::cpuScheduler().numThreads();
+  return threads>1 ? 4*threads : 1;
+}
+
+void petabricks::MatrixIOGeneral::_readTextHeader(MatrixReaderScratch& o){
+  int c;
+  do c = getc(_fd); while(isSpace(c));
+  for(const char* k="size"; *k!=0; ++k, c=getc(_fd))
+    JASSERT(c!=EOF && tolower(c)==*k)(c).Text("Unhandled input, expected SIZE");
+  o.dimensions=0;
+  for(;;){
+    while(c==' ' || c=='\t' || c=='\r' || c=='x' || c=='X') c=getc(_fd);
+    if(c=='\n' || c==EOF) break;
+    JASSERT(isDigit(c))(c).Text("Unhandled input in SIZE line");
+    JASSERT(o.dimensions+1 < MAX_DIMENSIONS)(o.dimensions)
+      .Text("Input matrix has too many dimensions, increase MAX_DIMENSIONS in config.h");
+    MatrixStorage::IndexT v = 0;
+    for(; isDigit(c); c=getc(_fd))
+      v = v*10 + (c-'0');
+    o.sizes[o.dimensions++] = v;
+  }
+}
+
+void petabricks::MatrixIOGeneral::_readText(MatrixReaderScratch& o){
+  _readTextHeader(o);
+  size_t n = 1;
+  for(int i=0; i<o.dimensions; ++i) n*=o.sizes[i];
+  o.storage = new MatrixStorage(n);
+  o.buf = o.storage->data();
+  o.remaining = n;
+  if(n==0) return;
+
+  //double buffered: the next chunk is read while the current one is parsed
+  int pieces = _textPieces();
+  size_t chunkBytes = pieces*theTextPieceBytes;
+  std::vector<char> bufs[2];
+  bufs[0].resize(chunkBytes);
+  bufs[1].resize(chunkBytes);
+  int cur = 0;
+  size_t len = fread(&bufs[cur][0], 1, chunkBytes, _fd);
+  bool eof = len<chunkBytes;
+  std::vector<DynamicTaskPtr> tasks;
+  while(o.remaining>0){
+    char* buf = &bufs[cur][0];
+    JASSERT(len>0).Text("Buffer underflow while reading input matrix");
+
+    //a chunk ends at whitespace, a partial element carries to the next one
+    size_t end = len;
+    if(!eof){
+      while(end>0 && !isSpace(buf[end-1])) --end;
+      JASSERT(end>0)(chunkBytes).Text("Unhandled input, element too long");
+    }
+
+    MatrixTextChunk chunk(buf, end, pieces);
+    spawnMatrixIOPieces<MatrixTextChunk, &MatrixTextChunk::countPiece>(chunk, pieces, tasks);
+    waitMatrixIOPieces(tasks);
+    size_t taken = chunk.assign(o.buf, o.remaining);
+    spawnMatrixIOPieces<MatrixTextChunk, &MatrixTextChunk::parsePiece>(chunk, pieces, tasks);
+
+    bool last = (taken==o.remaining);
+    size_t nextLen = 0;
+    if(!last){
+      char* next = &bufs[1-cur][0];
+      nextLen = len-end;
+      memcpy(next, buf+end, nextLen);
+      if(!eof){
+        size_t got = fread(next+nextLen, 1, chunkBytes-nextLen, _fd);
+        eof = got<chunkBytes-nextLen;
+        nextLen += got;
+      }
+    }
+    waitMatrixIOPieces(tasks);
+    o.buf += taken;
+    o.remaining -= taken;
+
+    if(last){
+      //give back what was read past the matrix if we can
+      off_t unread = len-chunk.consumed();
+      struct stat st;
+      if(unread>0 && fstat(fileno(_fd), &st)==0 && S_ISREG(st.st_mode)){
+        JWARNING(fseeko(_fd, -unread, SEEK_CUR)==0)(JASSERT_ERRNO);
+      }
+      break;
+    }
+    cur = 1-cur;
+    len = nextLen;
+  }
+}
+
+void petabricks::MatrixIOGeneral::_readBinary(MatrixReaderScratch& o){
+  MatrixBinaryHeader h;
+  JASSERT(fread(&h, sizeof h, 1, _fd)==1).Text("failed to read binary matrix header");
+  JASSERT(memcmp(h.magic, MatrixBinaryHeader::MAGIC(), sizeof h.magic)==0)
+    .Text("invalid binary matrix header");
+  bool swapped = (h.byteOrder != MatrixBinaryHeader::BYTEORDER);
+  if(swapped){
+    JASSERT(byteswap32(h.byteOrder) == MatrixBinaryHeader::BYTEORDER)(h.byteOrder)
+      .Text("invalid byte order mark in binary matrix");
+    h.version     = byteswap32(h.version);
+    h.elementType = byteswap32(h.elementType);
+    h.elementSize = byteswap32(h.elementSize);
+    h.dimensions  = byteswap32(h.dimensions);
+    h.dataOffset  = byteswap64(h.dataOffset);
+    for(int i=0; i<MAX_DIMENSIONS; ++i)
+      h.sizes[i] = byteswap64(h.sizes[i]);
+  }
+  JASSERT(h.version == MatrixBinaryHeader::FORMAT_VERSION)(h.version)
+    .Text("unsupported binary matrix version");
+  JASSERT(h.elementType == MatrixBinaryHeader::TYPE_FLOAT
+       && (h.elementSize == sizeof(float) || h.elementSize == sizeof(double)))
+    (h.elementType)(h.elementSize).Text("unsupported binary matrix element type");
+  JASSERT(h.dimensions < MAX_DIMENSIONS)(h.dimensions);
+  JASSERT(h.dataOffset >= sizeof h)(h.dataOffset);
+
+  size_t count = 1;
+  o.dimensions = h.dimensions;
+  for(int i=0; i<o.dimensions; ++i){
+    o.sizes[i] = h.sizes[i];
+    count *= h.sizes[i];
+  }
+  o.remaining = 0;
+
+  if(!swapped && h.elementSize == sizeof(ElementT) && _mapBinary(o, h, count)){
+    o.buf = o.storage->data() + count;
+    return;
+  }
+
+  //fall back to reading (and converting) a copy
+  for(size_t skip = h.dataOffset - sizeof h; skip > 0; --skip)
+    JASSERT(getc(_fd) != EOF).Text("truncated binary matrix");
+  o.storage = new MatrixStorage(count);
+  ElementT* out = o.storage->data();
+  char buf[4096*sizeof(double)];
+  size_t perBuf = sizeof buf / h.elementSize;
+  for(size_t done = 0; done < count; ){
+    size_t n = std::min(perBuf, count - done);
+    JASSERT(fread(buf, h.elementSize, n, _fd) == n)(done)(count).Text("truncated binary matrix");
+    for(size_t i=0; i<n; ++i){
+      char* p = buf + i*h.elementSize;
+      if(swapped) byteswapInPlace(p, h.elementSize);
+      if(h.elementSize == sizeof(float))
+        out[done+i] = *reinterpret_cast<float*>(p);
+      else
+        out[done+i] = *reinterpret_cast<double*>(p);
+    }
+    done += n;
+  }
+  o.buf = out + count;
+}
+
+bool petabricks::MatrixIOGeneral::_mapBinary(MatrixReaderScratch& o, const MatrixBinaryHeader& h, size_t count){
+  struct stat st;
+  int fd = fileno(_fd);
+  if(fstat(fd, &st)!=0 || !S_ISREG(st.st_mode))
+    return false;
+  off_t start = ftello(_fd) - (off_t)sizeof h;
+  if(start < 0 || start % sysconf(_SC_PAGESIZE) != 0 || h.dataOffset % sizeof(ElementT) != 0)
+    return false;
+  size_t len = h.dataOffset + count*sizeof(ElementT);
+  JASSERT(start + (off_t)len <= st.st_size)(len)(st.st_size).Text("truncated binary matrix");
+  void* p = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, start);
+  if(p == MAP_FAILED){
+    JTRACE("mmap failed, reading binary matrix instead")(JASSERT_ERRNO);
+    return false;
+  }
+  o.storage = new MatrixStorage(reinterpret_cast<ElementT*>(static_cast<char*>(p) + h.dataOffset), count, p, len);
+  JASSERT(fseeko(_fd, start + len, SEEK_SET)==0)(JASSERT_ERRNO);
+  return true;
+}
+
+void petabricks::MatrixIOGeneral::_writeBinaryHeader(int d, const MatrixStorage::IndexT* sizes){
+  MatrixBinaryHeader h;
+  memset(&h, 0, sizeof h);
+  memcpy(h.magic, MatrixBinaryHeader::MAGIC(), sizeof h.magic);
+  h.version     = MatrixBinaryHeader::FORMAT_VERSION;
+  h.byteOrder   = MatrixBinaryHeader::BYTEORDER;
+  h.elementType = MatrixBinaryHeader::TYPE_FLOAT;
+  h.elementSize = sizeof(ElementT);
+  h.dimensions  = d;
+  h.dataOffset  = MatrixBinaryHeader::ALIGNMENT;
+  for(int i=0; i<d; ++i)
+    h.sizes[i] = sizes[i];
+  JASSERT(fwrite(&h, sizeof h, 1, _fd)==1)(JASSERT_ERRNO).Text("write failed");
+  static const char zeros[MatrixBinaryHeader::ALIGNMENT] = {0};
+  JASSERT(fwrite(zeros, 1, h.dataOffset - sizeof h, _fd) == h.dataOffset - sizeof h)(JASSERT_ERRNO)
+    .Text("write failed");
+}
+
 // void petabricks::MatrixIO::write(const MATRIX_ELEMENT_T* buf, int h, int w){
 //   if(_fd == stdin) _fd = stdout;
 //   int i=0;
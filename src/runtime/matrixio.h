@@ -27,11 +27,17 @@
 #ifndef PETABRICKSMATRIXIO_H
 #define PETABRICKSMATRIXIO_H
 
+#include "dynamicscheduler.h"
+#include "dynamictask.h"
 #include "matrixregion.h"
 #include "regionmatrix.h"
 
 #include "common/jassert.h"
 
+#include <stdint.h>
+#include <string>
+#include <vector>
+
 #ifdef HAVE_CONFIG_H
 # include "config.h"
 #else
@@ -42,7 +48,7 @@
 namespace petabricks {
 
 /**
- * Struct for holding outputs of matrixreader.lpp, used for matrixread<->MatrixIO com
+ * Struct for holding outputs of the text and binary readers
  */
 struct MatrixReaderScratch {
   ///
@@ -53,18 +59,137 @@ struct MatrixReaderScratch {
   ElementT* buf;
   ///
   /// Remaining space in this->buf, should be zero on completion
-  int remaining;
+  size_t remaining;
   ///
   /// Number of dimensions
   int dimensions;
   ///
   /// Size of each dimension
-  int sizes[MAX_DIMENSIONS];
+  MatrixStorage::IndexT sizes[MAX_DIMENSIONS];
 };
 
 
 /**
- * A thin wrapper around matrixreader
+ * Header of the binary matrix format, raw elements in the same order as the
+ * text format (dimension 0 fastest) start at dataOffset from the header
+ */
+struct MatrixBinaryHeader {
+  static const char*    MAGIC()          { return "\x89PBMATRX"; }
+  static const uint32_t FORMAT_VERSION = 1;
+  static const uint32_t BYTEORDER      = 0x01020304;
+  static const uint32_t TYPE_FLOAT     = 'f';
+  static const uint64_t ALIGNMENT      = 4096;
+
+  char     magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t elementType;
+  uint32_t elementSize;
+  uint32_t dimensions;
+  uint32_t reserved;
+  uint64_t dataOffset;
+  uint64_t sizes[MAX_DIMENSIONS];
+};
+
+
+/**
+ * A task running one piece of a parallel matrix read or write
+ */
+template< typename T, void (T::*method)(int)>
+class MatrixIOPieceTask : public DynamicTask {
+public:
+  MatrixIOPieceTask(T& obj, int piece) : _obj(obj), _piece(piece) {}
+  DynamicTaskPtr run(){
+    (_obj.*method)(_piece);
+    return 0;
+  }
+private:
+  T& _obj;
+  int _piece;
+};
+
+///
+/// Spawn (obj.*method)(i) for each of n pieces on the worker pool,
+/// waitMatrixIOPieces() must be called before obj goes out of scope.
+/// A single piece, or a caller that is not a worker, runs them inline.
+template< typename T, void (T::*method)(int)>
+inline void spawnMatrixIOPieces(T& obj, int n, std::vector<DynamicTaskPtr>& tasks){
+  tasks.clear();
+  if(n<=1 || WorkerThread::self()==NULL){
+    for(int i=0; i<n; ++i)
+      (obj.*method)(i);
+    return;
+  }
+  for(int i=0; i<n; ++i){
+    DynamicTaskPtr t = new MatrixIOPieceTask<T, method>(obj, i);
+    t->enqueue();
+    tasks.push_back(t);
+  }
+}
+
+///
+/// Block until all tasks from spawnMatrixIOPieces() have completed
+inline void waitMatrixIOPieces(std::vector<DynamicTaskPtr>& tasks){
+  for(size_t i=0; i<tasks.size(); ++i)
+    tasks[i]->waitUntilComplete();
+  tasks.clear();
+}
+
+/**
+ * Formats a range of cells of a D>0 dimensional matrix as text, split into
+ * pieces so the formatting can run in parallel
+ */
+template<int D, typename T>
+class MatrixTextFormatter {
+public:
+  MatrixTextFormatter(T m, int pieces) : _m(m), _out(pieces), _begin(0), _end(0) {}
+
+  ///
+  /// Set the range of cells (in incCoord order) the next pieces cover
+  void setRange(ssize_t begin, ssize_t end) { _begin=begin; _end=end; }
+
+  ///
+  /// Format one piece of the current range into a buffer
+  void formatPiece(int piece){
+    std::string& out = _out[piece];
+    out.clear();
+    ssize_t n = _end-_begin;
+    ssize_t first = _begin + n*piece/(ssize_t)_out.size();
+    ssize_t last  = _begin + n*(piece+1)/(ssize_t)_out.size();
+    if(first>=last) return;
+    MatrixStorage::IndexT coord[D];
+    ssize_t rem = first;
+    for(int i=0; i<D; ++i){
+      coord[i] = rem % _m.size(i);
+      rem /= _m.size(i);
+    }
+    char buf[64];
+    for(ssize_t c=first; c<last; ++c){
+      int len = snprintf(buf, sizeof buf, "%4.8g ", (double) _m.cell(coord));
+      out.append(buf, len);
+      int z=_m.incCoord(coord);
+      if(z<0) break;
+      out.append(z, '\n');
+    }
+  }
+
+  ///
+  /// Write the formatted pieces, in order, to fd
+  void writeTo(FILE* fd){
+    for(size_t i=0; i<_out.size(); ++i){
+      JASSERT(fwrite(_out[i].data(), 1, _out[i].size(), fd)==_out[i].size())(JASSERT_ERRNO)
+        .Text("write failed");
+    }
+  }
+private:
+  T _m;
+  std::vector<std::string> _out;
+  ssize_t _begin;
+  ssize_t _end;
+};
+
+/**
+ * A thin wrapper around the matrix readers and writers
  */
 class MatrixIOGeneral{
 public:
@@ -73,9 +198,14 @@ public:
   MatrixIOGeneral(FILE* file = stdin);
 
   ///
-  /// Constructor (opens the given filename)
+  /// Constructor (opens the given filename), files ending in .pbmat are
+  /// written in the binary format
   MatrixIOGeneral(const char* filename, const char* mode);
 
+  ///
+  /// True if write() produces the binary format
+  bool isBinary() const { return _binary; }
+
 
   template<int D>
   MatrixRegion<D, MATRIX_ELEMENT_T> read_sequential(){
@@ -101,6 +231,23 @@ public:
     #endif
   }
 
+  ///
+  /// Read a D-dimensional matrix from _fd, converting its elements to T
+  template<int D, typename T>
+  MatrixRegion<D, T> read_typed(){
+    MatrixRegion<D, MATRIX_ELEMENT_T> m1 = read_workstealing<D>();
+    MatrixStorage::IndexT coord[D+1];
+    for(int i=0; i<D; ++i) coord[i]=m1.size(i);
+    MatrixRegion<D, T> m2 = MatrixRegion<D, T>::allocate(coord);
+    memset(coord, 0, sizeof coord);
+    if(m1.count()>0){
+      do{
+        m2.cell(coord) = (T) m1.cell(coord);
+      }while(D>0 && m1.incCoord(coord)>=0);
+    }
+    return m2;
+  }
+
   ///
   /// Read a D-dimensional matrix from _fd
   template<int D>
@@ -151,10 +298,26 @@ public:
   void write(RegionMatrixWrapper<D,T> m);
 
 protected:
+  ///
+  /// Number of pieces to split text parsing/formatting into
+  static int _textPieces();
+
   void _read(MatrixReaderScratch&);
+  void _readText(MatrixReaderScratch&);
+  void _readTextHeader(MatrixReaderScratch&);
+  void _readBinary(MatrixReaderScratch&);
+  bool _mapBinary(MatrixReaderScratch&, const MatrixBinaryHeader&, size_t count);
+  void _writeBinaryHeader(int d, const MatrixStorage::IndexT* sizes);
+
+  template<int D, typename T>
+  void _writeText(T m);
+
+  template<int D, typename T>
+  void _writeBinary(T m);
 
 private:
   FILE* _fd;
+  bool _binary;
 };
 
 
@@ -215,29 +378,11 @@ template<int D, typename T>
 inline void petabricks::MatrixIOGeneral::write(MatrixRegion<D,T> m){
   if(_fd==0)     return;
   if(_fd==stdin) _fd=stdout;
-  fprintf(_fd,"SIZE");
-  for(int i=0; i<D; ++i)
-    fprintf(_fd," %d",m.size(i));
-  fprintf(_fd,"\n");
-  if( m.count() == 0) {
+  if(_binary){
+    _writeBinary<D>(m);
     return;
   }
-  MatrixStorage::IndexT coord[D];
-  memset(coord, 0, sizeof coord);
-  if(D>0){
-    for(;;){
-      fprintf(_fd,"%4.8g ", (double) m.cell(coord));
-      int z=m.incCoord(coord);
-      if(z<0) break;
-      while(z-->0)
-        fprintf(_fd,"\n");
-    }
-    fprintf(_fd,"\n");
-  }else{ //0D case
-    fprintf(_fd,"%4.8g", (double) m.cell(coord));
-  }
-  fprintf(_fd,"\n");
-  fflush(_fd);
+  _writeText<D>(m);
 }
 
 ///
@@ -248,26 +393,72 @@ inline void petabricks::MatrixIOGeneral::write(RegionMatrixWrapper<D,T> m){
 
   if(_fd==0)     return;
   if(_fd==stdin) _fd=stdout;
+  if(_binary){
+    _writeBinary<D>(m);
+    return;
+  }
+  _writeText<D>(m);
+}
+
+///
+/// Write a given matrix to _fd in the text format, formatting blocks of
+/// cells in parallel
+template<int D, typename T>
+inline void petabricks::MatrixIOGeneral::_writeText(T m){
   fprintf(_fd,"SIZE");
   for(int i=0; i<D; ++i)
-    fprintf(_fd," %d",m.size(i));
+    fprintf(_fd," %ld",(long)m.size(i));
   fprintf(_fd,"\n");
-  MatrixStorage::IndexT coord[D];
-  memset(coord, 0, sizeof coord);
+  if( m.count() == 0) {
+    fflush(_fd);
+    return;
+  }
   if(D>0){
-    for(;;){
-      fprintf(_fd,"%4.8g ", (double) m.cell(coord));
-      int z=m.incCoord(coord);
-      if(z<0) break;
-      while(z-->0)
-        fprintf(_fd,"\n");
+    int pieces = _textPieces();
+    ssize_t count = m.count();
+    ssize_t block = pieces*65536;
+    MatrixTextFormatter<D, T> formatter(m, pieces);
+    std::vector<DynamicTaskPtr> tasks;
+    for(ssize_t begin=0; begin<count; begin+=block){
+      formatter.setRange(begin, std::min(count, begin+block));
+      spawnMatrixIOPieces<MatrixTextFormatter<D, T>, &MatrixTextFormatter<D, T>::formatPiece>(formatter, pieces, tasks);
+      waitMatrixIOPieces(tasks);
+      formatter.writeTo(_fd);
     }
     fprintf(_fd,"\n");
   }else{ //0D case
+    MatrixStorage::IndexT coord[1] = {0};
     fprintf(_fd,"%4.8g", (double) m.cell(coord));
   }
   fprintf(_fd,"\n");
   fflush(_fd);
 }
 
+///
+/// Write a given matrix to _fd in the binary format
+template<int D, typename T>
+inline void petabricks::MatrixIOGeneral::_writeBinary(T m){
+  MatrixStorage::IndexT coord[D];
+  for(int i=0; i<D; ++i)
+    coord[i]=m.size(i);
+  _writeBinaryHeader(D, coord);
+  if( m.count() == 0) {
+    fflush(_fd);
+    return;
+  }
+  ElementT buf[4096];
+  size_t n=0;
+  memset(coord, 0, sizeof coord);
+  for(;;){
+    buf[n++] = m.cell(coord);
+    if(n == sizeof buf / sizeof buf[0]){
+      JASSERT(fwrite(buf, sizeof buf[0], n, _fd)==n)(JASSERT_ERRNO).Text("write failed");
+      n=0;
+    }
+    if(D==0 || m.incCoord(coord)<0) break;
+  }
+  JASSERT(fwrite(buf, sizeof buf[0], n, _fd)==n)(JASSERT_ERRNO).Text("write failed");
+  fflush(_fd);
+}
+
 #endif
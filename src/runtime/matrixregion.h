@@ -89,9 +89,10 @@ struct MatrixRegionTypeSpec {
   enum { D = _D };
   typedef _ElementT ElementT;
   typedef MATRIX_INDEX_T IndexT;
-  typedef petabricks::MatrixStoragePtr StorageT;
+  typedef typename MatrixStorageSelect<ElementT>::MutableElementT MutableElementT;
+  typedef typename MatrixStorageSelect<ElementT>::StoragePtr StorageT;
   typedef petabricks::MatrixRegion<_slicesize<D>::D, ElementT> SliceMatrixRegion;
-  typedef petabricks::MatrixRegion<D, MATRIX_ELEMENT_T> MutableMatrixRegion;
+  typedef petabricks::MatrixRegion<D, MutableElementT>  MutableMatrixRegion;
   typedef petabricks::MatrixRegion<D, ElementT>         MatrixRegion;
 };
 
@@ -130,7 +131,7 @@ public:
 
     _base = b;
     _storage = s;
-    if(count()>0){
+    if(count()>0 && MatrixStorageSelect<ElementT>::HAS_INFO){
       _storageInfo = new MatrixStorageInfo();
       exportTo(_storageInfo);
     }
@@ -151,7 +152,8 @@ public:
     if(D==0){
       //0D version may not use storage(), so just set the element directly
       JASSERT(base()!=0);
-      *const_cast<MATRIX_ELEMENT_T*>(base()) = MatrixStorage::rand();
+      typedef typename TypeSpec::MutableElementT MutableElementT;
+      *const_cast<MutableElementT*>(base()) = (MutableElementT) MatrixStorage::rand();
     }else{
       this->storage()->randomize();
     }
@@ -161,7 +163,7 @@ public:
   /// export to a more generic container (used in memoization)
   void exportTo(MatrixStorageInfo& ms) const {
     //std::cerr << "MATRIXREGION:: dimension = " << D << "count = " << this->count() << std::endl;
-    ms.setStorage(_storage, _base);
+    MatrixStorageSelect<ElementT>::exportTo(ms, _storage, _base);
     ms.setSizeMultipliers(D, _multipliers, _sizes);
     ms.setExtraVal();
   }
@@ -178,6 +180,7 @@ public:
   ///
   /// copy from a more generic container (used in memoization)
   void copyFrom(const MatrixStorageInfo& ms){
+    JASSERT(MatrixStorageSelect<ElementT>::HAS_INFO);
     #ifdef DEBUG
     JASSERT(_base!=0);
     #endif
@@ -236,10 +239,10 @@ public:
     ssize_t s=1;
     for(int i=0; i<D; ++i)
       s*=sizes[i];
-    MatrixStoragePtr tmp = new MatrixStorage(s);
+    StorageT tmp = new typename MatrixStorageSelect<ElementT>::Storage(s);
     #ifdef DEBUG
     //in debug mode initialize matrix to garbage
-    for(int i=0; i<s; ++i)
+    for(ssize_t i=0; i<s; ++i)
       tmp->data()[i] = -666;
     #endif
     #ifdef COLUMN_MAJOR
@@ -254,7 +257,9 @@ public:
 
   ///
   ///same as allocate unless this->sizes()==sizes
-  bool isSize(const IndexT sizes[D]) const{
+  ///(a template so isSize(0) is not ambiguous when IndexT is not int)
+  template<typename P>
+  bool isSize(P* sizes) const{
     if(this->base()==0) return false;
     for(int i=0; i<D; ++i){
       if(this->sizes()[i]!=sizes[i]){
@@ -508,7 +513,7 @@ public:
 
   void modifyOnCpu(IndexT firstRow = 0) {
 #ifdef HAVE_OPENCL
-    if(D == 0 || count() == 0) return;
+    if(D == 0 || count() == 0 || !MatrixStorageSelect<ElementT>::HAS_INFO) return;
     this->storageInfo()->modifyOnCpu(firstRow);
 #endif
   }
@@ -731,7 +736,7 @@ protected:
         mult *= size(i);
       }
     }
-    if(count()>0)
+    if(count()>0 && MatrixStorageSelect<ElementT>::HAS_INFO)
       this->storageInfo()->setMultipliers(this->multipliers());
   }
 
@@ -746,6 +751,8 @@ protected:
  *
  * This part contains variable arg count methods.
  * GCC is bad at optimizing these, so we specialized these for commonly used types.
+ * With LARGE_INDEX the trailing arguments are read as a 64-bit IndexT, so
+ * callers of these (D>4) versions must not pass plain ints.
  */
 template< typename TypeSpec >
 class MatrixRegionVaArgsMethods : public MatrixRegionBasicMethods< TypeSpec > {
@@ -836,7 +843,7 @@ public:
 
   ///
   /// Constructor with a given layout
-  MatrixRegion( const MatrixStoragePtr& s
+  MatrixRegion( const typename TypeSpec::StorageT& s
               , ElementT* b
               , const IndexT sizes[D]
               , const IndexT multipliers[D])
@@ -845,7 +852,7 @@ public:
 
   ///
   /// Constructor with a stock layout
-  MatrixRegion( const MatrixStoragePtr& s
+  MatrixRegion( const typename TypeSpec::StorageT& s
               , ElementT* b
               , const IndexT sizes[D]
               , typename Base::StockLayouts layout = Base::LAYOUT_ASCENDING)
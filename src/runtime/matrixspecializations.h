@@ -45,7 +45,7 @@ public:
 
   ///
   /// Constructor with a given layout
-  MatrixRegion( const MatrixStoragePtr& s
+  MatrixRegion( const typename TypeSpec::StorageT& s
               , ElementT* b
               , const IndexT sizes[D]
               , const IndexT multipliers[D])
@@ -58,7 +58,7 @@ public:
 
   ///
   /// Constructor with a stock layout
-  MatrixRegion( const MatrixStoragePtr& s
+  MatrixRegion( const typename TypeSpec::StorageT& s
               , ElementT* b
               , const IndexT sizes[D]
               , typename Base::StockLayouts = Base::LAYOUT_ASCENDING)
@@ -96,14 +96,14 @@ protected:
 /**
  * Specialized storage for ConstMatrixRegion0D, just store the value directly
  */
-template<>
-class MatrixRegionMembers < MatrixRegionTypeSpec<0, const MATRIX_ELEMENT_T> > {
+template<typename T>
+class MatrixRegionMembers < MatrixRegionTypeSpec<0, const T> > {
 public:
   enum { D = 0 };
-  typedef MatrixRegionTypeSpec<0, const MATRIX_ELEMENT_T> TypeSpec;
-  typedef TypeSpec::ElementT ElementT;
-  typedef TypeSpec::IndexT   IndexT;
-  typedef TypeSpec::StorageT StorageT;
+  typedef MatrixRegionTypeSpec<0, const T> TypeSpec;
+  typedef typename TypeSpec::ElementT ElementT;
+  typedef typename TypeSpec::IndexT   IndexT;
+  typedef typename TypeSpec::StorageT StorageT;
   
   MatrixRegionMembers(const StorageT&, ElementT* b, const IndexT* , const IndexT*)
     : _val(b!=NULL ? *b : -666)
@@ -118,7 +118,10 @@ public:
   const StorageT& storage() const { static StorageT dummy; return dummy; }
   const MatrixStorageInfoPtr storageInfo() const { return _storageInfo; }
 
-  void randomize(){ _val = MatrixStorage::rand(); }
+  void randomize(){
+    double min = MatrixStorage::randMin();
+    _val = (T)(min + (MatrixStorage::randMax()-min)*CounterRandom().uniform(0));
+  }
   
   ///
   /// export to a more generic container (used in memoization)
@@ -137,13 +140,13 @@ public:
   ///
   /// import from a more generic container (used in memoization)
   void copyFrom(MatrixStorageInfo& ms){
-    _val = ms.extraVal();
+    _val = (T) ms.extraVal();
   }
 protected: 
   IndexT* sizes() { return NULL; }
   IndexT* multipliers() { return NULL; };
 private:
-  MATRIX_ELEMENT_T _val;
+  T _val;
   MatrixStorageInfoPtr _storageInfo;
 };
 
@@ -209,11 +212,16 @@ public:
     : Base(s,b,sizes,multipliers)
   {}
   
-  //these passthroughs must be declared here for overloading to work
-  INLINE ElementT& cell(IndexT c[D]) const{ return this->Base::cell(c); }
-  INLINE bool contains(IndexT c[D]) const{ return this->Base::contains(c); }
-  INLINE MatrixRegion region(const IndexT c1[D], const IndexT c2[D]) const{ return this->Base::region(c1,c2); }
-  INLINE static MatrixRegion allocate(IndexT s[D]){ return Base::allocate(s); }
+  //these passthroughs must be declared here for overloading to work, they
+  //are templates so cell(0) is not ambiguous when IndexT is not int
+  template<typename P>
+  INLINE ElementT& cell(P* c) const{ return this->Base::cell(c); }
+  template<typename P>
+  INLINE bool contains(P* c) const{ return this->Base::contains(c); }
+  template<typename P1, typename P2>
+  INLINE MatrixRegion region(P1* c1, P2* c2) const{ return this->Base::region(c1,c2); }
+  template<typename P>
+  INLINE static MatrixRegion allocate(P* s){ return Base::allocate(s); }
   
   INLINE static MatrixRegion allocate(IndexT x){
     IndexT c1[] = {x};
@@ -198,14 +198,22 @@ void petabricks::MatrixStorage::addDoneCopyOut(MatrixStorageInfoPtr info) {
 }
 #endif
 
+petabricks::MatrixStorage::~MatrixStorage(){
+  StoragePool::release(_block);
+}
+
 MATRIX_ELEMENT_T petabricks::MatrixStorage::rand(){
-  return petabricks::PetabricksRuntime::randDouble(-2147483648, 2147483648);
+  //same generator as randomize(), so 0D inputs are counter based too
+  double min = randMin();
+  return (MATRIX_ELEMENT_T)(min + (randMax()-min)*CounterRandom().uniform(0));
 }
 
 void petabricks::MatrixStorage::randomize(){
-  for(size_t i=0;i<_count; ++i){
-    _data[i] = MatrixStorage::rand();
-  }
+  randomize(CounterRandom());
+}
+
+void petabricks::MatrixStorage::randomize(const CounterRandom& r){
+  r.parallelFill(_data, _count, randMin(), randMax());
 }
 
 petabricks::MatrixStorageInfo::MatrixStorageInfo(){
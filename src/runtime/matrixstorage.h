@@ -32,6 +32,9 @@
 #include <cmath>
 #include <math.h>
 
+#include "counterrandom.h"
+#include "storagepool.h"
+
 #include "common/hash.h"
 #include "common/jassert.h"
 #include "common/jmutex.h"
@@ -99,7 +102,8 @@ public:
   ///
   /// Constructor
   MatrixStorage(size_t n) : _count(n) {
-    _data = new ElementT[n];
+    _block = StoragePool::allocate(n*sizeof(ElementT));
+    _data = static_cast<ElementT*>(_block.ptr);
 #ifdef DEBUG
     // initialize elements to NaN
     for (size_t i = 0; i < n; i++) {
@@ -109,24 +113,43 @@ public:
   }
 
   ///
-  /// Destructor
-  ~MatrixStorage(){
-    delete [] _data;
+  /// Constructor that takes ownership of a mmap()ed file, whose n
+  /// elements start at data
+  MatrixStorage(ElementT* data, size_t n, void* mapping, size_t mappingLength)
+    : _data(data), _count(n)
+  {
+    _block.ptr = mapping;
+    _block.capacity = mappingLength;
+    _block.length = mappingLength;
+    _block.kind = StoragePool::BLOCK_FILE;
   }
 
+  ///
+  /// Destructor
+  ~MatrixStorage();
+
   ElementT* data() { return _data; }
   const ElementT* data() const { return _data; }
 
   size_t count() const { return _count; }
 
   ///
-  /// Fill the matrix with random data
+  /// Fill the matrix with random data from a new stream
   void randomize();
 
   ///
-  /// generate a single random number
+  /// Fill the matrix with random data from the given stream
+  void randomize(const CounterRandom& r);
+
+  ///
+  /// generate a single random number, the first element of a new stream
   static MATRIX_ELEMENT_T rand();
 
+  ///
+  /// Range of rand() and randomize()
+  static double randMin() { return -2147483648.0; }
+  static double randMax() { return 2147483648.0; }
+
   HashT hash() const {
     jalib::HashGenerator g;
     float *temp = new float[_count];
@@ -159,6 +182,7 @@ public:
 private:
   ElementT* _data;
   size_t _count;
+  StoragePool::Block _block;
 #ifdef HAVE_OPENCL
   std::set<MatrixStorageInfoPtr> _needcopyout;
   std::set<MatrixStorageInfoPtr> _donecopyout;
@@ -168,6 +192,57 @@ private:
 };
 
 
+/**
+ * The raw data for a Matrix whose elements are not MATRIX_ELEMENT_T, these
+ * are only ever used on the CPU
+ */
+template<typename T>
+class TypedMatrixStorage : public jalib::JRefCounted {
+public:
+  typedef MATRIX_INDEX_T IndexT;
+  typedef T ElementT;
+private:
+  //no copy constructor
+  TypedMatrixStorage(const TypedMatrixStorage&);
+public:
+  ///
+  /// Constructor
+  TypedMatrixStorage(size_t n) : _count(n) {
+    _block = StoragePool::allocate(n*sizeof(ElementT));
+    _data = static_cast<ElementT*>(_block.ptr);
+  }
+
+  ///
+  /// Destructor
+  ~TypedMatrixStorage() {
+    StoragePool::release(_block);
+  }
+
+  ElementT* data() { return _data; }
+  const ElementT* data() const { return _data; }
+
+  size_t count() const { return _count; }
+
+  ///
+  /// Fill the matrix with random data
+  void randomize(){
+    randomize(CounterRandom());
+  }
+
+  void randomize(const CounterRandom& r){
+    r.parallelFill(_data, _count, MatrixStorage::randMin(), MatrixStorage::randMax());
+  }
+
+#ifdef HAVE_OPENCL
+  void updateDataFromGpu(MatrixStorageInfoPtr, IndexT = 0) {}
+#endif
+
+private:
+  ElementT* _data;
+  size_t _count;
+  StoragePool::Block _block;
+};
+
 /**
  * Capable of storing any type of MatrixRegion plus a hash of its data
  */
@@ -542,6 +617,36 @@ private:
 #endif
 };
 
+/**
+ * Picks the storage used for matrices of a given element type, only
+ * MATRIX_ELEMENT_T matrices can be exported to a MatrixStorageInfo (used in
+ * memoization and by the GPU code)
+ */
+template<typename T>
+struct MatrixStorageSelect {
+  enum { HAS_INFO = false };
+  typedef T MutableElementT;
+  typedef TypedMatrixStorage<T> Storage;
+  typedef jalib::JRef<Storage> StoragePtr;
+
+  static void exportTo(MatrixStorageInfo&, const StoragePtr&, const T*){
+    JASSERT(false).Text("only MATRIX_ELEMENT_T matrices can be memoized");
+  }
+};
+template<typename T>
+struct MatrixStorageSelect<const T> : public MatrixStorageSelect<T> {};
+template<>
+struct MatrixStorageSelect<MATRIX_ELEMENT_T> {
+  enum { HAS_INFO = true };
+  typedef MATRIX_ELEMENT_T MutableElementT;
+  typedef MatrixStorage Storage;
+  typedef MatrixStoragePtr StoragePtr;
+
+  static void exportTo(MatrixStorageInfo& ms, const StoragePtr& s, const MATRIX_ELEMENT_T* base){
+    ms.setStorage(s, base);
+  }
+};
+
 class CopyoutInfo : public jalib::JRefCounted {
   typedef MatrixStorage::IndexT IndexT;
 public:
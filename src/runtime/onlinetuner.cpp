@@ -0,0 +1,202 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "onlinetuner.h"
+
+#include "choiceprofiler.h"
+
+#include "common/jassert.h"
+#include "common/jconvert.h"
+#include "common/jmutex.h"
+#include "common/jtunable.h"
+
+#include <map>
+#include <vector>
+
+bool petabricks::OnlineTuner::_enabled = false;
+long petabricks::OnlineTuner::_minN = 0;
+
+namespace { //file local
+  typedef petabricks::ChoiceSite ChoiceSite;
+
+  ///
+  /// Samples of both choices needed before comparing them
+  const long theMinSamples = 8;
+  /// An alternative must be this much cheaper (per element) to be adopted
+  const double theMargin = 0.9;
+
+  long thePeriod = 50;
+  double theOverhead = 0.05;
+
+  jalib::JMutex theLock;
+  double theObservedSeconds = 0;
+  double theExploreSeconds = 0;
+  long theExplored = 0;
+  long theAdopted = 0;
+
+  struct Arm {
+    long count;
+    double costSum;
+    Arm() : count(0), costSum(0) {}
+    double mean() const { return costSum/count; }
+  };
+
+  typedef std::vector<Arm> Bucket;
+
+  /**
+   * The decision tree tunables and statistics of one ChoiceSite
+   */
+  struct Site {
+    bool resolved;
+    int arms;
+    long nextAlt;
+    std::vector<jalib::JTunable*> rules;   ///< lvlL_rule at L-1
+    std::vector<jalib::JTunable*> cutoffs; ///< lvl(L+1)_cutoff at L-1
+    std::map<int, Bucket> buckets;         ///< by floor(log2(n))
+    Site() : resolved(false), arms(0), nextAlt(0) {}
+  };
+  std::map<int, Site> theSites;
+
+  int floorLog2(long n){
+    int lg = 0;
+    while(n > 1){
+      n >>= 1;
+      ++lg;
+    }
+    return lg;
+  }
+
+  ///
+  /// Find the tunables behind a site, arms stays 0 if they are not
+  /// changeable (hardcoded or specialized configs)
+  Site& lookup(const ChoiceSite& cs){
+    Site& s = theSites[cs.id()];
+    if(s.resolved)
+      return s;
+    s.resolved = true;
+    jalib::JTunableReverseMap m = jalib::JTunableManager::instance().getReverseMap();
+    for(int lvl=1; ; ++lvl){
+      std::string pfx = std::string(cs.name()) + "_lvl";
+      jalib::JTunableReverseMap::const_iterator r = m.find(pfx + jalib::XToString(lvl) + "_rule");
+      if(r == m.end())
+        break;
+      s.rules.push_back(r->second);
+      jalib::JTunableReverseMap::const_iterator c = m.find(pfx + jalib::XToString(lvl+1) + "_cutoff");
+      s.cutoffs.push_back(c != m.end() ? c->second : NULL);
+    }
+    if(!s.rules.empty())
+      s.arms = s.rules[0]->max().i() + 1;
+    return s;
+  }
+
+  ///
+  /// Index of the decision tree level handling n
+  size_t levelFor(const Site& s, long n){
+    size_t lvl = 0;
+    while(lvl+1 < s.rules.size() && s.cutoffs[lvl] != NULL && n >= s.cutoffs[lvl]->value().i())
+      ++lvl;
+    return lvl;
+  }
+
+  ///
+  /// Switch the level of n to alt if alt is cheaper in every bucket of the
+  /// level where both have been measured
+  void maybeAdopt(Site& s, long n, int def, int alt){
+    size_t lvl = levelFor(s, n);
+    if(s.rules[lvl]->value().i() != def)
+      return; //changed since this call was made
+    bool measured = false;
+    for(std::map<int, Bucket>::const_iterator b=s.buckets.begin(); b!=s.buckets.end(); ++b){
+      if(levelFor(s, 1L<<b->first) != lvl && b->first != floorLog2(n))
+        continue;
+      const Arm& d = b->second[def];
+      const Arm& a = b->second[alt];
+      if(d.count < theMinSamples || a.count < theMinSamples)
+        continue;
+      if(a.mean() > theMargin*d.mean())
+        return;
+      measured = true;
+    }
+    if(!measured)
+      return;
+    JTRACE("online tuning adopted choice")(s.rules[lvl]->name())(def)(alt);
+    s.rules[lvl]->setValue(alt);
+    ++theAdopted;
+    //old measurements of this level were made under the old choice
+    for(std::map<int, Bucket>::iterator b=s.buckets.begin(); b!=s.buckets.end(); ++b)
+      if(levelFor(s, 1L<<b->first) == lvl)
+        b->second.assign(b->second.size(), Arm());
+  }
+}
+
+void petabricks::OnlineTuner::enable(double rate, double overhead, long minN){
+  JASSERT(rate > 0 && rate <= 1)(rate).Text("--online-tune-rate must be in (0, 1]");
+  thePeriod = (long)(1.0/rate + 0.5);
+  theOverhead = overhead;
+  _minN = minN;
+  _enabled = true;
+}
+
+int petabricks::OnlineTuner::explore(const ChoiceSite& cs, long /*n*/, int defaultChoice){
+  static __thread long calls = 0;
+  if(++calls % thePeriod != 0)
+    return defaultChoice;
+  //racy read, the budget is a soft limit
+  if(theExploreSeconds > theOverhead*theObservedSeconds)
+    return defaultChoice;
+  JLOCKSCOPE(theLock);
+  Site& s = lookup(cs);
+  if(s.arms < 2 || defaultChoice < 0 || defaultChoice >= s.arms)
+    return defaultChoice;
+  ++theExplored;
+  return (defaultChoice + 1 + (s.nextAlt++ % (s.arms-1))) % s.arms;
+}
+
+void petabricks::OnlineTuner::observe(const ChoiceSite& cs, long n, int choice, int defaultChoice, double seconds){
+  if(!_enabled || n < _minN)
+    return;
+  JLOCKSCOPE(theLock);
+  theObservedSeconds += seconds;
+  if(choice != defaultChoice)
+    theExploreSeconds += seconds;
+  Site& s = lookup(cs);
+  if(s.arms < 2 || choice < 0 || choice >= s.arms || defaultChoice < 0 || defaultChoice >= s.arms)
+    return;
+  Bucket& b = s.buckets[floorLog2(n)];
+  if(b.empty())
+    b.resize(s.arms);
+  b[choice].count++;
+  b[choice].costSum += seconds/(n>0 ? n : 1);
+  if(choice != defaultChoice)
+    maybeAdopt(s, n, defaultChoice, choice);
+}
+
+void petabricks::OnlineTuner::dumpStats(std::ostream& o){
+  o << "<onlinetuning explored=\"" << theExplored << "\""
+    << " adopted=\"" << theAdopted << "\""
+    << " explore_seconds=\"" << theExploreSeconds << "\""
+    << " observed_seconds=\"" << theObservedSeconds << "\" />";
+}
@@ -24,87 +24,52 @@
  *    http://projects.csail.mit.edu/petabricks/                              *
  *                                                                           *
  *****************************************************************************/
-%option caseless
-%option nostdinit
-%option noyywrap
-%option nounput
-%option prefix="matrixreader"
-%option outfile="lex.yy.c"
-
-%{
-
-#include "matrixio.h"
-
-#include "common/jassert.h"
-#include "common/jconvert.h"
-
-#ifdef HAVE_CONFIG_H
-#  include "config.h"
-#endif
-
-#include <stdio.h>
-
-using namespace petabricks;
-
-#define YY_DECL int matrixreaderlex(MatrixReaderScratch& o)
-
-YY_DECL;
-
-%}
-
-%x DATA
-%x SIZE
-
-%%
-
-<INITIAL>{
-  [ \r\t]+              //nothing
-  [\n]                  //nothing
-  "size"                {
-    o.dimensions=0;
-    BEGIN(SIZE);
-  }
-}
-
-<SIZE>{
-  [ \r\tx]+              //nothing
-  [0-9]+                {
-    JASSERT(o.dimensions+1 < MAX_DIMENSIONS)(o.dimensions)
-      .Text("Input matrix has too many dimensions, increase MAX_DIMENSIONS in config.h");
-    o.sizes[o.dimensions++] = jalib::StringToX<int>(yytext);
-  }
-  [\n]                  {
-    int n=1;
-    for(int i=0; i<o.dimensions; ++i) n*=o.sizes[i];
-    o.storage=new petabricks::MatrixStorage(n);
-    o.buf = o.storage->data();
-    o.remaining = n;
-    if(n>0) {
-      BEGIN(DATA);
-    } else {
-      BEGIN(INITIAL);
-    }
-  }
-}
-
-<DATA>{
-  [ \r\t]+              //nothing
-  [\n]                  //nothing
-  [-]?[0-9]+[.]?[0-9]*[e]?[+-]?[0-9]* {
-    JASSERT(o.remaining>0).Text("Buffer underflow while reading input matrix");
-    *o.buf++ = jalib::StringToX<MATRIX_ELEMENT_T>(yytext);
-    if(--o.remaining == 0){
-      BEGIN(INITIAL);
-      return 0;
-    }
+#ifndef PETABRICKSONLINETUNER_H
+#define PETABRICKSONLINETUNER_H
+
+#include <iostream>
+
+namespace petabricks {
+
+class ChoiceSite;
+
+/**
+ * Opt-in (--online-tune) re-tuning of schedule selectors while a program
+ * runs: a small fraction of sequential calls try a different choice, the
+ * cost per element of every choice is kept per power-of-two size bucket,
+ * and when an alternative wins across a whole level of the decision tree
+ * the level's _rule tunable is changed (and saved with the config at exit)
+ */
+class OnlineTuner {
+public:
+  ///
+  /// Start exploring about rate of the calls with at least minN elements,
+  /// stop whenever exploring took more than overhead of the observed time
+  static void enable(double rate, double overhead, long minN);
+  static bool enabled() { return _enabled; }
+
+  ///
+  /// The choice to use for this call, usually defaultChoice
+  static int choose(const ChoiceSite& site, long n, int defaultChoice){
+    if(!_enabled || n < _minN)
+      return defaultChoice;
+    return explore(site, n, defaultChoice);
   }
-}
 
-<*>{
-  . JASSERT(false)(yytext).Text("Unhandled input");
-}
+  ///
+  /// Record how long a call with the given choice took
+  static void observe(const ChoiceSite& site, long n, int choice, int defaultChoice, double seconds);
 
-%%
+  ///
+  /// Write the exploration counters as an xml element
+  static void dumpStats(std::ostream& o);
+private:
+  static int explore(const ChoiceSite& site, long n, int defaultChoice);
 
+  static bool _enabled;
+  static long _minN;
+};
 
+}
 
+#endif
@@ -0,0 +1,228 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "perfcounters.h"
+
+#include "common/jasm.h"
+#include "common/jassert.h"
+#include "common/jmutex.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+#endif
+
+bool petabricks::PerfCounters::_enabled = false;
+
+namespace { //file local
+  typedef petabricks::PerfSample PerfSample;
+  typedef petabricks::PerfSite PerfSite;
+
+  std::string theFilename;
+
+  //sites are function-local statics, registered the first time their
+  //function runs, possibly on several threads at once
+  jalib::JMutex theLock;
+  std::vector<const PerfSite*> theSites;
+  //kind and name to id, so sites sharing a name share one row
+  std::map<std::string, int> theSiteIds;
+
+  /**
+   * The samples and hardware counters owned by one thread, only the owner
+   * writes to it, dump() reads every table once the workers are idle
+   */
+  struct ThreadTable {
+    std::vector<PerfSample> samples;
+    int hwLeader;
+    bool hwOpened;
+    ThreadTable() : hwLeader(-1), hwOpened(false) {}
+  };
+  std::vector<ThreadTable*> theTables;
+
+  ThreadTable& myTable(){
+    static __thread ThreadTable* t = NULL;
+    if(t==NULL){
+      t = new ThreadTable();
+      JLOCKSCOPE(theLock);
+      theTables.push_back(t);
+    }
+    return *t;
+  }
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  int openHw(uint64_t config, int group){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = (group == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    //pid 0, cpu -1: this thread on any cpu
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+  }
+
+  ///
+  /// Open cycles, instructions and llc misses as one group for this thread
+  void openHwGroup(ThreadTable& t){
+    t.hwOpened = true;
+    int leader = openHw(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if(leader < 0)
+      return;
+    if(openHw(PERF_COUNT_HW_INSTRUCTIONS, leader) < 0
+    || openHw(PERF_COUNT_HW_CACHE_MISSES, leader) < 0){
+      close(leader);
+      return;
+    }
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    t.hwLeader = leader;
+  }
+#endif
+
+  PerfSample totalFor(int id){
+    PerfSample total;
+    memset(&total, 0, sizeof(total));
+    for(size_t t=0; t<theTables.size(); ++t){
+      if(id >= (int)theTables[t]->samples.size())
+        continue;
+      const PerfSample& s = theTables[t]->samples[id];
+      total.invocations += s.invocations;
+      total.tasks += s.tasks;
+      total.cells += s.cells;
+      total.seconds += s.seconds;
+      for(int i=0; i<PerfSample::HW_COUNT; ++i)
+        total.hw[i] += s.hw[i];
+    }
+    return total;
+  }
+
+  const char* kindName(PerfSite::Kind k){
+    return k == PerfSite::RULE ? "rule" : "transform";
+  }
+}
+
+petabricks::PerfSite::PerfSite(const char* name, Kind kind)
+  : _name(name), _kind(kind)
+{
+  JLOCKSCOPE(theLock);
+  std::string key = std::string(kindName(kind)) + ":" + name;
+  std::map<std::string, int>::const_iterator i = theSiteIds.find(key);
+  if(i != theSiteIds.end()){
+    _id = i->second;
+    return;
+  }
+  _id = theSites.size();
+  theSiteIds[key] = _id;
+  theSites.push_back(this);
+}
+
+void petabricks::PerfCounters::enable(const std::string& filename){
+  theFilename = filename;
+  _enabled = true;
+}
+
+bool petabricks::PerfCounters::readHw(uint64_t* hw){
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  ThreadTable& t = myTable();
+  if(!t.hwOpened)
+    openHwGroup(t);
+  if(t.hwLeader < 0)
+    return false;
+  uint64_t buf[1+PerfSample::HW_COUNT];
+  if(read(t.hwLeader, buf, sizeof(buf)) != (ssize_t)sizeof(buf))
+    return false;
+  for(int i=0; i<PerfSample::HW_COUNT; ++i)
+    hw[i] = buf[1+i];
+  return true;
+#else
+  (void)hw;
+  return false;
+#endif
+}
+
+petabricks::PerfSample& petabricks::PerfCounters::sample(const PerfSite& site){
+  ThreadTable& t = myTable();
+  if(site.id() >= (int)t.samples.size()){
+    PerfSample zero;
+    memset(&zero, 0, sizeof(zero));
+    t.samples.resize(site.id()+1, zero);
+  }
+  return t.samples[site.id()];
+}
+
+void petabricks::PerfCounters::dump(){
+  if(!_enabled)
+    return;
+  JLOCKSCOPE(theLock);
+  std::ofstream o(theFilename.c_str());
+  JASSERT(o.is_open())(theFilename).Text("failed to open --perfcounters output");
+  bool json = theFilename.size()>=5 && theFilename.substr(theFilename.size()-5) == ".json";
+  if(json)
+    o << "[\n";
+  else
+    o << "kind,name,invocations,tasks,cells,seconds,cycles,instructions,llc_misses\n";
+  bool first = true;
+  for(size_t i=0; i<theSites.size(); ++i){
+    PerfSample s = totalFor(i);
+    if(s.invocations == 0)
+      continue;
+    if(json){
+      o << (first ? "" : ",\n")
+        << "  {\"kind\": \"" << kindName(theSites[i]->kind()) << "\""
+        << ", \"name\": \"" << theSites[i]->name() << "\""
+        << ", \"invocations\": " << s.invocations
+        << ", \"tasks\": " << s.tasks
+        << ", \"cells\": " << s.cells
+        << ", \"seconds\": " << s.seconds
+        << ", \"cycles\": " << s.hw[PerfSample::HW_CYCLES]
+        << ", \"instructions\": " << s.hw[PerfSample::HW_INSTRUCTIONS]
+        << ", \"llc_misses\": " << s.hw[PerfSample::HW_LLC_MISSES]
+        << "}";
+    }else{
+      o << kindName(theSites[i]->kind()) << ','
+        << theSites[i]->name() << ','
+        << s.invocations << ','
+        << s.tasks << ','
+        << s.cells << ','
+        << s.seconds << ','
+        << s.hw[PerfSample::HW_CYCLES] << ','
+        << s.hw[PerfSample::HW_INSTRUCTIONS] << ','
+        << s.hw[PerfSample::HW_LLC_MISSES] << '\n';
+    }
+    first = false;
+  }
+  if(json)
+    o << "\n]\n";
+}
@@ -0,0 +1,134 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PETABRICKSPERFCOUNTERS_H
+#define PETABRICKSPERFCOUNTERS_H
+
+#include "common/jtimer.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace petabricks {
+
+/**
+ * One instrumented rule or transform, generated code declares these as
+ * function-local statics when compiled with pbc --perfcounters
+ */
+class PerfSite {
+public:
+  enum Kind { RULE, TRANSFORM };
+
+  PerfSite(const char* name, Kind kind);
+
+  int id() const { return _id; }
+  const char* name() const { return _name; }
+  Kind kind() const { return _kind; }
+private:
+  const char* _name;
+  Kind _kind;
+  int _id;
+};
+
+/**
+ * Totals for one site on one thread
+ */
+struct PerfSample {
+  enum { HW_CYCLES, HW_INSTRUCTIONS, HW_LLC_MISSES, HW_COUNT };
+  uint64_t invocations;
+  uint64_t tasks;
+  uint64_t cells;
+  double   seconds;
+  uint64_t hw[HW_COUNT];
+};
+
+/**
+ * Per-thread, lock free aggregation of PerfScope samples, dumped at exit
+ */
+class PerfCounters {
+public:
+  ///
+  /// Start recording and write the totals to filename at exit, as json if
+  /// the name ends in .json and csv otherwise
+  static void enable(const std::string& filename);
+  static bool enabled() { return _enabled; }
+
+  ///
+  /// Write the totals of every thread to the file given to enable()
+  static void dump();
+
+  ///
+  /// Read the calling thread's hardware counters, false if unavailable
+  static bool readHw(uint64_t* hw);
+
+  ///
+  /// The calling thread's totals for site
+  static PerfSample& sample(const PerfSite& site);
+private:
+  static bool _enabled;
+};
+
+/**
+ * Records one invocation of a site, from construction to destruction
+ */
+class PerfScope {
+public:
+  PerfScope(const PerfSite& site, uint64_t cells, bool isTask = false)
+    : _site(site), _cells(cells), _isTask(isTask), _hasHw(false), _start(jalib::JTime::null())
+  {
+    if(PerfCounters::enabled()){
+      _hasHw = PerfCounters::readHw(_hw);
+      _start = jalib::JTime::now();
+    }
+  }
+
+  ~PerfScope(){
+    if(PerfCounters::enabled()){
+      jalib::JTime end = jalib::JTime::now();
+      PerfSample& s = PerfCounters::sample(_site);
+      s.invocations++;
+      s.cells += _cells;
+      s.seconds += end-_start;
+      if(_isTask) s.tasks++;
+      uint64_t hw[PerfSample::HW_COUNT];
+      if(_hasHw && PerfCounters::readHw(hw)){
+        for(int i=0; i<PerfSample::HW_COUNT; ++i)
+          s.hw[i] += hw[i]-_hw[i];
+      }
+    }
+  }
+private:
+  const PerfSite& _site;
+  uint64_t _cells;
+  bool _isTask;
+  bool _hasHw;
+  jalib::JTime _start;
+  uint64_t _hw[PerfSample::HW_COUNT];
+};
+
+}
+
+#endif
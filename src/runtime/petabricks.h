@@ -25,6 +25,7 @@
  *                                                                           *
  *****************************************************************************/
 
+#include "choiceprofiler.h"
 #include "dynamictask.h"
 #include "gpudynamictask.h"
 #include "gpumanager.h"
@@ -33,6 +34,7 @@
 #include "matrixio.h"
 #include "matrixregion.h"
 #include "memoization.h"
+#include "perfcounters.h"
 #include "petabricksruntime.h"
 #include "remotetask.h"
 #include "ruleinstance.h"
@@ -44,6 +46,7 @@
 
 #include <algorithm>
 #include <limits.h>
+#include <vector>
 
 #ifdef HAVE_CONFIG_H
 #  include "config.h"
@@ -110,7 +113,12 @@ void _petabricksCleanup();
 #define _PB_CAT(a,b) __PB_CAT(a,b)
 #define __PB_CAT(a,b) a ## b
 
-#define PB_SYNC() sync_in_loops_not_supported_yet!
+#define PB_SYNC() petabricks::sync_now(_completion)
+
+/// direct back edges an expanded loop takes before yielding to the scheduler
+#ifndef PB_LOOP_INLINE_ITERS
+#define PB_LOOP_INLINE_ITERS 64
+#endif
 
 #define IS_MISSING petabricks::is_the_missing_val
 
@@ -176,6 +184,15 @@ namespace petabricks {
     }
   }
 
+  ///
+  /// blocking sync for code that cannot be split into continuations: wait
+  /// (while helping run other tasks) for everything spawned so far
+  inline void sync_now(DynamicTaskPtr& completion){
+    DynamicTaskPtr tmp = completion;
+    completion = new NullDynamicTask();
+    enqueue_and_wait(tmp);
+  }
+
   inline int size_to_bin(IndexT size){
     return (int)log2(size);
   }
@@ -208,8 +225,10 @@ namespace petabricks {
     return rv;
   }
 
-  template < int D , int blockNumber>
-  inline bool split_condition(IndexT thresh, IndexT begin[D], IndexT end[D]){
+  ///
+  /// should a D dimensional iteration space be split into blockNumber^D parts?
+  template < int D >
+  inline bool split_condition(IndexT thresh, int blockNumber, IndexT begin[D], IndexT end[D]){
     //too small to split?
     for(int i=0; i<D; ++i)
       if(end[i]-begin[i] < blockNumber)
@@ -222,6 +241,76 @@ namespace petabricks {
     return false;
   }
 
+  template < int D , int blockNumber>
+  inline bool split_condition(IndexT thresh, IndexT begin[D], IndexT end[D]){
+    return split_condition<D>(thresh, blockNumber, begin, end);
+  }
+
+  ///
+  /// the dimension a bisecting split cuts, ties go to the outermost
+  template < int D >
+  inline int longest_dimension(IndexT begin[D], IndexT end[D]){
+    int d = D-1;
+    for(int i=D-2; i>=0; --i)
+      if(end[i]-begin[i] > end[d]-begin[d])
+        d = i;
+    return d;
+  }
+
+  ///
+  /// should a self dependent D dimensional iteration space be cut into a
+  /// wavefront of tiles?  a tile size of 0 disables wavefronts
+  template < int D >
+  inline bool wavefront_condition(IndexT tile, IndexT begin[D], IndexT end[D]){
+    if(tile <= 0)
+      return false;
+    for(int i=0; i<D; ++i)
+      if(end[i]-begin[i] > tile)
+        return true;
+    return false;
+  }
+
+  ///
+  /// spawn a task calling method for each tile of the iteration space, each
+  /// depending on its neighbouring tiles against dir (dir[d] is 1 if
+  /// dimension d must be iterated forward, -1 if backward, 0 if it carries
+  /// no dependency); returns a task that completes once every tile has
+  template < typename T, int D, DynamicTaskPtr (T::*method)(IndexT begin[D], IndexT end[D]) >
+  inline DynamicTaskPtr spawn_wavefront(T* obj, IndexT begin[D], IndexT end[D], IndexT tile, const int dir[D]){
+    IndexT count[D];
+    IndexT stride[D];
+    IndexT total = 1;
+    for(int d=0; d<D; ++d){
+      count[d] = (end[d]-begin[d]+tile-1)/tile;
+      stride[d] = total;
+      total *= count[d];
+    }
+    //tiles are numbered in iteration order, so predecessors already exist
+    //and are enqueued before their dependents
+    std::vector<DynamicTaskPtr> tiles(total);
+    DynamicTaskPtr all = new NullDynamicTask();
+    IndexT c[D];
+    std::fill(c, c+D, 0);
+    for(IndexT n=0; n<total; ++n){
+      IndexT b[D];
+      IndexT e[D];
+      for(int d=0; d<D; ++d){
+        IndexT t = dir[d]<0 ? count[d]-1-c[d] : c[d];
+        b[d] = begin[d] + t*tile;
+        e[d] = std::min(b[d]+tile, end[d]);
+      }
+      tiles[n] = new SpatialMethodCallTask<T, D, method>(obj, b, e);
+      for(int d=0; d<D; ++d)
+        if(dir[d]!=0 && c[d]>0)
+          tiles[n]->dependsOn(tiles[n-stride[d]]);
+      tiles[n]->enqueue();
+      all->dependsOn(tiles[n]);
+      for(int d=0; d<D && ++c[d]==count[d]; ++d)
+        c[d] = 0;
+    }
+    return all;
+  }
+
   //special val for optional values that dont exist
   inline ElementT the_missing_val() {
     union {
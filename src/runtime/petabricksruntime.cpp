@@ -26,10 +26,16 @@
  *****************************************************************************/
 #include "petabricksruntime.h"
 
+#include "choiceprofiler.h"
+#include "counterrandom.h"
 #include "dynamicscheduler.h"
 #include "dynamictask.h"
 #include "gpudynamictask.h"
 #include "gpumanager.h"
+#include "matrixallocator.h"
+#include "perfcounters.h"
+#include "regionhandler.h"
+#include "storagepool.h"
 #include "petabricks.h"
 #include "remotehost.h"
 #include "subregioncachemanager.h"
@@ -134,6 +140,7 @@ static boost::lagged_fibonacci607& myRandomGen(){
 
 static void _seedRandom(){
   srand48(jalib::JTime::now().usec());
+  petabricks::CounterRandom::setSeed(jalib::JTime::now().usec());
 }
 
 double petabricks::PetabricksRuntime::rand01(){
@@ -272,6 +279,36 @@ petabricks::PetabricksRuntime::PetabricksRuntime(int argc, const char** argv, Ma
 
   args.param("threads", worker_threads).help("number of threads to use");
 
+  std::string alloc_policy = MatrixAllocator::policyName(MatrixAllocator::policy());
+  if(args.param("alloc-policy", alloc_policy).help("allocation of large matrices: heap, thp, hugetlb, firsttouch or interleave")){
+    JASSERT(MatrixAllocator::setPolicy(alloc_policy))(alloc_policy)
+      .Text("unknown --alloc-policy");
+  }
+
+  int pool_mb = StoragePool::limit()/(1024*1024);
+  if(args.param("storage-pool-mb", pool_mb).help("megabytes of freed matrix storage kept for reuse (0 disables)")){
+    StoragePool::setLimit((size_t)pool_mb*1024*1024);
+  }
+
+  std::string perfcounters_file;
+  if(args.param("perfcounters", perfcounters_file).help("write per-rule/transform counters to this csv (or .json) file, needs pbc --perfcounters")){
+    PerfCounters::enable(perfcounters_file);
+  }
+
+  std::string choiceprofile_file;
+  if(args.param("choiceprofile", choiceprofile_file).help("write the choice made by each schedule selector, per input size, to this csv file")){
+    ChoiceProfiler::enable(choiceprofile_file);
+  }
+
+  double online_rate = 0.02, online_overhead = 0.05;
+  int online_min_n = 256;
+  args.param("online-tune-rate", online_rate).help("fraction of calls --online-tune explores an alternative choice on");
+  args.param("online-tune-overhead", online_overhead).help("stop exploring once it took this fraction of the observed time");
+  args.param("online-tune-min-n", online_min_n).help("smallest input size --online-tune measures");
+  if(args.param("online-tune").help("re-tune schedule selectors while running, saving better choices to the config")){
+    OnlineTuner::enable(online_rate, online_overhead, online_min_n);
+  }
+
   if(args.needHelp())
     std::cerr << std::endl << "ALTERNATE EXECUTION MODES:" << std::endl;
 
@@ -589,12 +626,27 @@ int petabricks::PetabricksRuntime::runMain(){
     std::cout << "    <timing";
     _dumpStats(std::cout, theTimings);
     std::cout << " />\n";
+    std::cout << "    ";
+    MatrixAllocator::dumpStats(std::cout);
+    std::cout << "\n    ";
+    StoragePool::dumpStats(std::cout);
+    std::cout << "\n    ";
+    ScratchRegionStats::dumpStats(std::cout);
+    std::cout << "\n";
+    if(OnlineTuner::enabled()){
+      std::cout << "    ";
+      OnlineTuner::dumpStats(std::cout);
+      std::cout << "\n";
+    }
   }
   if(HASH){
     std::cout << "    <outputhash value=\"0x" << theLastHash << "\" />\n";
   }
   if(ACCURACY || DUMPTIMING || HASH) std::cout << "  </stats>\n</root>\n" << std::flush;
 
+  PerfCounters::dump();
+  ChoiceProfiler::dump();
+
   return _rv;
 }
 
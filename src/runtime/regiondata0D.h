@@ -31,7 +31,7 @@ namespace petabricks {
     void incRefCount() const { jalib::JRefCounted::incRefCount(); }
     void decRefCount() const { jalib::JRefCounted::decRefCount(); }
 
-    int allocData() {
+    IndexT allocData() {
       return 0;
     }
 
@@ -43,8 +43,9 @@ namespace petabricks {
       *_value = value;
     }
 
-    void randomize() {
-      *_value = MatrixStorage::rand();
+    using RegionDataI::randomize;
+    void randomize(const CounterRandom& r) {
+      r.fill(_value, 0, 1, MatrixStorage::randMin(), MatrixStorage::randMax());
     }
 
     RegionDataIPtr hosts(const IndexT* /*begin*/, const IndexT* /*end*/, DataHostPidList& list) {
@@ -109,7 +110,7 @@ namespace petabricks {
     void incRefCount() const { jalib::JRefCounted::incRefCount(); }
     void decRefCount() const { jalib::JRefCounted::decRefCount(); }
 
-    int allocData() {
+    IndexT allocData() {
       return 0;
     }
 
@@ -121,8 +122,9 @@ namespace petabricks {
       JASSERT(false);
     }
 
-    void randomize() {
-      _value = MatrixStorage::rand();
+    using RegionDataI::randomize;
+    void randomize(const CounterRandom& r) {
+      r.fill(&_value, 0, 1, MatrixStorage::randMin(), MatrixStorage::randMax());
     }
 
     RegionDataIPtr hosts(const IndexT* /*begin*/, const IndexT* /*end*/, DataHostPidList& list) {
@@ -75,7 +75,8 @@ void RegionDataI::processAllocDataMsg(const BaseMessageHeader* base, size_t, IRe
 }
 
 void RegionDataI::processRandomizeDataMsg(const BaseMessageHeader* base, size_t, IRegionReplyProxy* caller) {
-  this->randomize();
+  RandomizeDataMessage* msg = (RandomizeDataMessage*)base->content();
+  this->randomize(CounterRandom(msg->seed, msg->stream));
   RandomizeDataReplyMessage reply;
   size_t len = sizeof(RandomizeDataReplyMessage);
   caller->sendReply(&reply, len, base, MessageTypes::RANDOMIZEDATA);
@@ -169,7 +170,7 @@ IndexT RegionDataI::toRegionDataIndex(int dimensions, const IndexT* coord, int n
 void RegionDataI::print() {
   printf("RegionData: SIZE");
   for (int d = 0; d < _D; d++) {
-    printf(" %d", _size[d]);
+    printf(" %ld", (long)_size[d]);
   }
   printf("\n");
 
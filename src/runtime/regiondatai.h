@@ -30,7 +30,7 @@ namespace petabricks {
     virtual void incRefCount() const = 0;
     virtual void decRefCount() const = 0;
 
-    virtual int allocData() = 0;
+    virtual IndexT allocData() = 0;
     virtual void allocDataNonBlock(jalib::AtomicT* /*responseCounter*/) { allocData(); }
 
     virtual ElementT readCell(const IndexT* coord) const = 0;
@@ -49,10 +49,15 @@ namespace petabricks {
     }
 
     virtual void randomize() {
-      this->storage()->randomize();
+      this->randomize(CounterRandom());
+    }
+
+    virtual void randomize(const CounterRandom& r) {
+      this->storage()->randomize(r);
     }
 
     virtual void randomizeNonBlock(jalib::AtomicT* /*responseCounter*/) { randomize(); }
+    virtual void randomizeNonBlock(const CounterRandom& r, jalib::AtomicT* /*responseCounter*/) { randomize(r); }
 
     // for toLocalRegion
     virtual ElementT& value0D(const IndexT* /*coord*/) const {
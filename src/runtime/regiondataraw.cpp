@@ -26,7 +26,7 @@ void RegionDataRaw::init(const int dimensions, const IndexT* size, const Element
   memcpy(_size, size, sizeof(IndexT) * _D);
 
   if (data) {
-    int numData = allocData();
+    IndexT numData = allocData();
     memcpy(_storage->data(), data, sizeof(ElementT) * numData);
   }
 
@@ -36,11 +36,11 @@ void RegionDataRaw::init(const int dimensions, const IndexT* size, const Element
   }
 }
 
-int RegionDataRaw::allocData() {
+IndexT RegionDataRaw::allocData() {
   if (_storage) {
     return 0;
   }
-  int numData = 1;
+  IndexT numData = 1;
   for (int i = 0; i < _D; i++) {
     numData *= _size[i];
   }
@@ -232,7 +232,7 @@ void RegionDataRaw::processCopyFromMatrixStorageMsg(const BaseMessageHeader* bas
   memset(coord, 0, sizeof coord);
 
   do {
-    unsigned int index = toRegionDataIndex(d, coord, metadata->numSliceDimensions, metadata->splitOffset, metadata->sliceDimensions(), metadata->slicePositions(), _multipliers);
+    IndexT index = toRegionDataIndex(d, coord, metadata->numSliceDimensions, metadata->splitOffset, metadata->sliceDimensions(), metadata->slicePositions(), _multipliers);
     #ifdef DEBUG
     JASSERT(index <= _storage->count())(index)(_storage->count());
     #endif
@@ -25,7 +25,7 @@ namespace petabricks {
 
     ElementT readCell(const IndexT* coord) const;
     void writeCell(const IndexT* coord, ElementT value);
-    int allocData();
+    IndexT allocData();
 
     MatrixStoragePtr storage() const {return _storage;}
     void setStorage(MatrixStoragePtr storage) { _storage = storage; }
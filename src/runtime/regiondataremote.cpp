@@ -62,7 +62,7 @@ void RegionDataRemote::createRemoteObject() const {
   host->createRemoteObject(const_cast<RegionDataRemote*>(this), &RegionMatrixProxy::genRemote, &msg, len);
 }
 
-int RegionDataRemote::allocData() {
+IndexT RegionDataRemote::allocData() {
   void* data;
   size_t len;
   int type;
@@ -71,7 +71,7 @@ int RegionDataRemote::allocData() {
   len = len - base->contentOffset;
   AllocDataReplyMessage* reply = (AllocDataReplyMessage*) base->content();
 
-  ElementT result = reply->result;
+  IndexT result = reply->result;
   free(data);
   return result;
 }
@@ -81,15 +81,30 @@ void RegionDataRemote::allocDataNonBlock(jalib::AtomicT* responseCounter) {
 }
 
 void RegionDataRemote::randomize() {
+  randomize(CounterRandom());
+}
+
+void RegionDataRemote::randomize(const CounterRandom& r) {
+  RandomizeDataMessage msg;
+  msg.seed = r.seedValue();
+  msg.stream = r.streamValue();
+
   void* data;
   size_t len;
   int type;
-  this->fetchData(0, MessageTypes::RANDOMIZEDATA, 0, &data, &len, &type);
+  this->fetchData(&msg, MessageTypes::RANDOMIZEDATA, sizeof(RandomizeDataMessage), &data, &len, &type);
   free(data);
 }
 
 void RegionDataRemote::randomizeNonBlock(jalib::AtomicT* responseCounter) {
-  this->fetchDataNonBlock(0, MessageTypes::RANDOMIZEDATA, 0, responseCounter);
+  randomizeNonBlock(CounterRandom(), responseCounter);
+}
+
+void RegionDataRemote::randomizeNonBlock(const CounterRandom& r, jalib::AtomicT* responseCounter) {
+  RandomizeDataMessage msg;
+  msg.seed = r.seedValue();
+  msg.stream = r.streamValue();
+  this->fetchDataNonBlock(&msg, MessageTypes::RANDOMIZEDATA, sizeof(RandomizeDataMessage), responseCounter);
 }
 
 const RemoteRegionHandler* RegionDataRemote::remoteRegionHandler() const {
@@ -253,7 +268,7 @@ RegionDataIPtr RegionDataRemote::copyToScratchMatrixStorage(CopyToMatrixStorageM
     int d = origMetadata->dimensions;
     IndexT* size = origMetadata->size();
 
-    int n = 0;
+    IndexT n = 0;
     IndexT coord[d];
     memset(coord, 0, sizeof coord);
     IndexT multipliers[d];
@@ -291,7 +306,7 @@ void RegionDataRemote::copyFromScratchMatrixStorage(CopyFromMatrixStorageMessage
     memcpy(origMsg->storage(), scratchStorage->data(), sizeof(ElementT) * storageCount);
 
   } else {
-    int n = 0;
+    IndexT n = 0;
     IndexT coord[d];
     memset(coord, 0, sizeof coord);
     IndexT multipliers[d];
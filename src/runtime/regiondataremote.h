@@ -43,10 +43,12 @@ namespace petabricks {
 
     void init(const int dimensions, const IndexT* size);
 
-    int allocData();
+    IndexT allocData();
     void allocDataNonBlock(jalib::AtomicT* responseCounter);
     void randomize();
+    void randomize(const CounterRandom& r);
     void randomizeNonBlock(jalib::AtomicT* responseCounter);
+    void randomizeNonBlock(const CounterRandom& r, jalib::AtomicT* responseCounter);
 
     const RemoteRegionHandler* remoteRegionHandler() const;
 
@@ -227,6 +227,8 @@ namespace petabricks {
     } PACKED;
 
     struct RandomizeDataMessage {
+      uint64_t seed;
+      uint64_t stream;
     } PACKED;
 
     struct CopyRegionDataSplitMessage {
@@ -281,7 +283,7 @@ namespace petabricks {
     } PACKED;
 
     struct AllocDataReplyMessage {
-      int result;
+      IndexT result;
     } PACKED;
 
     struct RandomizeDataReplyMessage {
@@ -93,7 +93,7 @@ void RegionDataSplit::setPart(int partIndex, const RemoteRegionHandler& remoteRe
   //_parts[partIndex]->updateHandlerChain();
 }
 
-int RegionDataSplit::allocData() {
+IndexT RegionDataSplit::allocData() {
   jalib::AtomicT responseCounter = 0;
   for (int i = 0; i < _numParts-1; i++) {
     if (!_parts[i]) {
@@ -109,11 +109,17 @@ int RegionDataSplit::allocData() {
 }
 
 void RegionDataSplit::randomize() {
+  randomize(CounterRandom());
+}
+
+void RegionDataSplit::randomize(const CounterRandom& r) {
+  // each part draws from its own stream, derived from r so the result does
+  // not depend on which node fills which part
   jalib::AtomicT responseCounter = 0;
   for (int i = 0; i < _numParts-1; i++) {
-    _parts[i]->randomizeNonBlock(&responseCounter);
+    _parts[i]->randomizeNonBlock(CounterRandom(r.seedValue(), r.bits(i)), &responseCounter);
   }
-  _parts[_numParts-1]->randomize();
+  _parts[_numParts-1]->randomize(CounterRandom(r.seedValue(), r.bits(_numParts-1)));
   while (responseCounter != 0) {
     jalib::memFence();
   }
@@ -204,11 +210,11 @@ void RegionDataSplit::copyHelper(bool isCopyTo, RegionMatrixMetadata* origMetada
 
   size_t len = RegionMatrixMetadata::len(origMetadata->dimensions, origMetadata->numSliceDimensions);
   if (!isCopyTo) {
-    int count = 1;
+    IndexT count = 1;
     for (int i = 0; i < origMetadata->dimensions; ++i) {
       count *= origMetadata->size()[i];
     }
-    int partCount = 1;
+    IndexT partCount = 1;
     for (int i = 0; i < _D; ++i) {
       sliceIndex = 0;
       if (sliceIndex < origMetadata->numSliceDimensions && i == origMetadata->sliceDimensions()[sliceIndex]) {
@@ -32,13 +32,14 @@ namespace petabricks {
     void incRefCount() const { jalib::JRefCounted::incRefCount(); }
     void decRefCount() const { jalib::JRefCounted::decRefCount(); }
 
-    int allocData();
+    IndexT allocData();
     void createPart(int partIndex, RemoteHostPtr host);
     void setPart(int partIndex, const RemoteRegionHandler& remoteRegionHandler);
     IndexT numParts() const { return _numParts; }
     // RegionHandlerPtr part(IndexT i) const { return _parts[i]; }
 
     void randomize();
+    void randomize(const CounterRandom& r);
 
     ElementT readCell(const IndexT* coord) const;
     void writeCell(const IndexT* coord, ElementT value);
@@ -6,6 +6,8 @@
 #include "regiondatasplit.h"
 #include "regionmatrixproxy.h"
 
+#include "common/jasm.h"
+
 using namespace petabricks;
 using namespace petabricks::RegionDataRemoteMessage;
 
@@ -47,10 +49,18 @@ void RegionHandler::randomize() {
   regionData()->randomize();
 }
 
+void RegionHandler::randomize(const CounterRandom& r) {
+  regionData()->randomize(r);
+}
+
 void RegionHandler::randomizeNonBlock(jalib::AtomicT* responseCounter) {
   regionData()->randomizeNonBlock(responseCounter);
 }
 
+void RegionHandler::randomizeNonBlock(const CounterRandom& r, jalib::AtomicT* responseCounter) {
+  regionData()->randomizeNonBlock(r, responseCounter);
+}
+
 int RegionHandler::allocData() {
   return _regionData->allocData();
 }
@@ -630,3 +640,31 @@ RegionHandlerPtr RegionHandlerDB::getLocalRegionHandler(const HostPid& hostPid,
   return localHandler;
 }
 
+
+//
+// ScratchRegionStats
+//
+
+namespace {
+  jalib::AtomicT theAliasedCount = 0;
+  jalib::AtomicT theAliasedBytes = 0;
+  jalib::AtomicT theCopiedCount = 0;
+  jalib::AtomicT theCopiedBytes = 0;
+}
+
+void ScratchRegionStats::aliased(size_t bytes) {
+  jalib::atomicAdd<1>(&theAliasedCount);
+  jalib::atomicAdd(&theAliasedBytes, (long)bytes);
+}
+
+void ScratchRegionStats::copied(size_t bytes) {
+  jalib::atomicAdd<1>(&theCopiedCount);
+  jalib::atomicAdd(&theCopiedBytes, (long)bytes);
+}
+
+void ScratchRegionStats::dumpStats(std::ostream& o) {
+  o << "<scratchregions aliased=\"" << theAliasedCount << "\""
+    << " aliased_kb=\"" << theAliasedBytes/1024 << "\""
+    << " copied=\"" << theCopiedCount << "\""
+    << " copied_kb=\"" << theCopiedBytes/1024 << "\" />";
+}
@@ -7,6 +7,7 @@
 #include "remotehost.h"
 #include "subregioncachemanager.h"
 
+#include <iostream>
 #include <map>
 
 #define NUM_CACHE_ITEMS 3
@@ -79,7 +80,9 @@ namespace petabricks {
     ElementT readCell(const IndexT* coord);
     void writeCell(const IndexT* coord, ElementT value);
     void randomize();
+    void randomize(const CounterRandom& r);
     void randomizeNonBlock(jalib::AtomicT* responseCounter);
+    void randomizeNonBlock(const CounterRandom& r, jalib::AtomicT* responseCounter);
 
     int allocData();
     int allocData(const IndexT* size, int distributedCutoff, int distributionType, int distributionSize, int migrationType);
@@ -159,6 +162,20 @@ namespace petabricks {
 
   };
 
+  /**
+   * Bytes of scratch regions for distributed rules that were aliased to
+   * data already on this node, and bytes that had to be copied
+   */
+  class ScratchRegionStats {
+  public:
+    static void aliased(size_t bytes);
+    static void copied(size_t bytes);
+
+    ///
+    /// Write the counters as an xml element
+    static void dumpStats(std::ostream& o);
+  };
+
   typedef std::map<EncodedPtr, RegionHandlerPtr> LocalRegionHandlerMap;
 
   class RegionHandlerDB {
@@ -191,7 +191,10 @@ namespace petabricks {
       _regionHandler->allocDataLocal(_size);
     }
 
-    static RegionMatrix allocate(const IndexT size[D]) {
+    //the pointer argument versions of allocate, isSize, contains, cell and
+    //region are templates so cell(0) is not ambiguous when IndexT is not int
+    template<typename P>
+    static RegionMatrix allocate(P* size) {
       RegionMatrix region = RegionMatrix(size);
       region.allocDataLocal();
       return region;
@@ -230,7 +233,8 @@ namespace petabricks {
       }
       return _size[i];
     }
-    bool isSize(const IndexT size[D]) const{
+    template<typename P>
+    bool isSize(P* size) const{
       if (!_size) {
         return false;
       }
@@ -247,7 +251,8 @@ namespace petabricks {
     IndexT height() const { return size(1); }
     IndexT depth() const { return size(2); }
 
-    bool contains(const IndexT coord[D]) const {
+    template<typename P>
+    bool contains(P* coord) const {
       for(int i=0; i<D; ++i)
         if(coord[i]<0 || coord[i]>=size(i))
           return false;
@@ -262,7 +267,8 @@ namespace petabricks {
       return s;
     }
 
-    CellProxy cell(IndexT coord[D]) const {
+    template<typename P>
+    CellProxy cell(P* coord) const {
       IndexT rd_coord[_regionHandler->dimensions()];
       regionDataCoord(coord, rd_coord);
       return CellProxy(_regionHandler, rd_coord);
@@ -344,7 +350,8 @@ namespace petabricks {
         (size, offset, _isTransposed, sliceInfo, _regionHandler);
     }
 
-    RegionMatrixWrapper<D, ElementT> region(const IndexT c1[D], const IndexT c2[D]) const{
+    template<typename P1, typename P2>
+    RegionMatrixWrapper<D, ElementT> region(P1* c1, P2* c2) const{
       IndexT newSizes[D];
       for(int i=0; i<D; ++i){
         #ifdef DEBUG
@@ -772,6 +779,45 @@ namespace petabricks {
       return copy;
     }
 
+    //
+    // True if all of this region's data is in one buffer on this node, in
+    // which case localCopy() aliases it rather than copying
+    bool isAliasable() const {
+      if (isRegionDataRaw()) {
+        return true;
+      }
+      if (D == 0 || _regionHandler->shouldIgnoreDuringScheduling()) {
+        return false;
+      }
+      DataHostPidList list;
+      dataHosts(list);
+      // hosts() replaces a handle to remote split data with a local split
+      return _regionHandler->type() == RegionDataTypes::REGIONDATASPLIT
+        && list.size() == 1
+        && list[0].hostPid == HostPid::self();
+    }
+
+    //
+    // Scratch region for a distributed rule. Same as localCopy(), but the
+    // scratch buffer is only allocated if the data actually has to move.
+    RegionMatrix localScratch(bool isFromMatrix=false) const {
+      size_t bytes = count() * sizeof(ElementT);
+      if (isRegionDataRaw()) {
+        ScratchRegionStats::aliased(bytes);
+        return *this;
+      }
+      if (isAliasable()) {
+        // localCopy() swaps in the handler of the part holding the data
+        RegionMatrix alias = RegionMatrix(this->size(), new RegionHandler(D, this->size(), false));
+        localCopy(alias, isFromMatrix);
+        JASSERT(alias.regionData()->storage()).Text("local split region was not aliased");
+        ScratchRegionStats::aliased(bytes);
+        return alias;
+      }
+      ScratchRegionStats::copied(bytes);
+      return localCopy(isFromMatrix);
+    }
+
     //
     // copy to workstealing region
     //
@@ -974,7 +1020,7 @@ namespace petabricks {
           slice_index++;
         } else {
           // split
-          int offset = _splitOffset[split_index];
+          IndexT offset = _splitOffset[split_index];
 
           if (_isTransposed) {
             coord_new[d] = coord_orig[D - 1 - split_index] + offset;
@@ -0,0 +1,190 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "storagepool.h"
+
+#include "matrixallocator.h"
+
+#include "common/jasm.h"
+#include "common/jassert.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <new>
+#include <vector>
+
+namespace { //file local
+  typedef petabricks::StoragePool::Block Block;
+
+  ///
+  /// Buffers up to this size are left to malloc, which already caches them
+  const size_t theMinPooled = 1024;
+  /// 4 size classes per power of two, at most 25% wasted
+  const int theClassBits = 2;
+  const int theBucketCount = 4*64;
+
+  size_t theLimit = 256*1024*1024;
+
+  jalib::AtomicT theRetained = 0;
+  jalib::AtomicT thePeakRetained = 0;
+  jalib::AtomicT theHits = 0;
+  jalib::AtomicT theMisses = 0;
+  jalib::AtomicT theEvictions = 0;
+
+  ///
+  /// Round bytes up to its size class and find the bucket for it
+  size_t sizeClass(size_t bytes, int& bucket){
+    size_t n = bytes-1;
+    int lg = 0;
+    while((n>>lg) > 1) ++lg;
+    int shift = lg-theClassBits;
+    bucket = (lg-10)*(1<<theClassBits) + ((n>>shift)&((1<<theClassBits)-1));
+    return ((n>>shift)+1)<<shift;
+  }
+
+  /**
+   * The free buffers cached by one thread
+   */
+  struct ThreadCache {
+    std::vector<Block> buckets[theBucketCount];
+  };
+
+  void freeBlock(const Block& b){
+    switch(b.kind){
+      case petabricks::StoragePool::BLOCK_HEAP:
+        free(b.ptr);
+        break;
+      case petabricks::StoragePool::BLOCK_MAPPED:
+      case petabricks::StoragePool::BLOCK_FILE:
+        JWARNING(munmap(b.ptr, b.length)==0)(JASSERT_ERRNO).Text("munmap failed");
+        break;
+    }
+  }
+
+  __thread ThreadCache* theCache = NULL;
+  __thread char theCacheBuf[sizeof(ThreadCache)] __attribute__((aligned));
+  pthread_key_t theCacheKey;
+  pthread_once_t theCacheKeyOnce = PTHREAD_ONCE_INIT;
+
+  ///
+  /// Thread exit: free everything the thread still caches
+  void destroyCache(void* p){
+    ThreadCache* c = (ThreadCache*)p;
+    for(int i=0; i<theBucketCount; ++i){
+      std::vector<Block>& cached = c->buckets[i];
+      for(size_t j=0; j<cached.size(); ++j){
+        jalib::atomicAdd(&theRetained, -(long)cached[j].capacity);
+        freeBlock(cached[j]);
+      }
+    }
+    c->~ThreadCache();
+    theCache = NULL;
+  }
+
+  void makeCacheKey(){
+    JASSERT(pthread_key_create(&theCacheKey, &destroyCache)==0);
+  }
+
+  ThreadCache& myCache(){
+    if(theCache==NULL){
+      pthread_once(&theCacheKeyOnce, &makeCacheKey);
+      theCache = new (theCacheBuf) ThreadCache();
+      JASSERT(pthread_setspecific(theCacheKey, theCache)==0);
+    }
+    return *theCache;
+  }
+}
+
+petabricks::StoragePool::Block petabricks::StoragePool::allocate(size_t bytes){
+  Block b;
+  int bucket = -1;
+  b.capacity = bytes;
+  if(bytes > theMinPooled){
+    b.capacity = sizeClass(bytes, bucket);
+    std::vector<Block>& cached = myCache().buckets[bucket];
+    if(!cached.empty()){
+      b = cached.back();
+      cached.pop_back();
+      jalib::atomicAdd(&theRetained, -(long)b.capacity);
+      jalib::atomicIncrement(&theHits);
+      return b;
+    }
+    if(theLimit > 0)
+      jalib::atomicIncrement(&theMisses);
+  }
+  b.length = 0;
+  b.ptr = MatrixAllocator::map(b.capacity, b.length);
+  if(b.ptr != NULL){
+    b.kind = BLOCK_MAPPED;
+  }else{
+    b.kind = BLOCK_HEAP;
+    b.ptr = malloc(b.capacity>0 ? b.capacity : 1);
+    JASSERT(b.ptr != NULL)(b.capacity).Text("out of memory");
+  }
+  return b;
+}
+
+void petabricks::StoragePool::release(const Block& b){
+  if(b.kind == BLOCK_FILE || b.capacity <= theMinPooled || theLimit == 0){
+    freeBlock(b);
+    return;
+  }
+  long retained = jalib::atomicAdd(&theRetained, (long)b.capacity);
+  if((size_t)retained > theLimit){
+    jalib::atomicAdd(&theRetained, -(long)b.capacity);
+    jalib::atomicIncrement(&theEvictions);
+    freeBlock(b);
+    return;
+  }
+  //racy max, only used for reporting
+  if(retained > thePeakRetained)
+    thePeakRetained = retained;
+  int bucket;
+  sizeClass(b.capacity, bucket);
+  myCache().buckets[bucket].push_back(b);
+}
+
+void petabricks::StoragePool::setLimit(size_t bytes){
+  theLimit = bytes;
+}
+
+size_t petabricks::StoragePool::limit(){
+  return theLimit;
+}
+
+size_t petabricks::StoragePool::retained(){
+  return theRetained;
+}
+
+void petabricks::StoragePool::dumpStats(std::ostream& o){
+  o << "<storagepool limit_mb=\"" << theLimit/(1024*1024) << "\""
+    << " hits=\"" << theHits << "\""
+    << " misses=\"" << theMisses << "\""
+    << " evictions=\"" << theEvictions << "\""
+    << " retained_kb=\"" << theRetained/1024 << "\""
+    << " peak_retained_kb=\"" << thePeakRetained/1024 << "\" />";
+}
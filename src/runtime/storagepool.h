@@ -0,0 +1,82 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PETABRICKSSTORAGEPOOL_H
+#define PETABRICKSSTORAGEPOOL_H
+
+#include <cstddef>
+#include <iostream>
+
+namespace petabricks {
+
+/**
+ * Size bucketed, per-thread cache of the buffers behind MatrixStorage, so
+ * the temporaries of recursive transforms are recycled instead of going
+ * back to malloc/munmap each time the last reference drops
+ */
+class StoragePool {
+public:
+  enum Kind {
+    BLOCK_HEAP,   ///< from malloc()
+    BLOCK_MAPPED, ///< anonymous mapping from MatrixAllocator::map()
+    BLOCK_FILE    ///< mmap()ed file, never pooled
+  };
+
+  /**
+   * A buffer handed out by the pool
+   */
+  struct Block {
+    void*  ptr;
+    size_t capacity; ///< usable bytes (rounded up to the size class)
+    size_t length;   ///< length of the mapping for BLOCK_MAPPED/BLOCK_FILE
+    Kind   kind;
+  };
+
+  ///
+  /// Get a buffer of at least bytes, from this thread's cache if possible
+  static Block allocate(size_t bytes);
+
+  ///
+  /// Return a buffer to this thread's cache, or free it if over the limit
+  static void release(const Block& b);
+
+  ///
+  /// Cap on bytes retained by all caches (0 disables pooling)
+  static void setLimit(size_t bytes);
+  static size_t limit();
+
+  ///
+  /// Bytes currently held by all thread caches
+  static size_t retained();
+
+  ///
+  /// Write the pool counters as an xml element
+  static void dumpStats(std::ostream& o);
+};
+
+}
+
+#endif
@@ -0,0 +1,149 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "petabricks.h"
+#include "matrixallocator.h"
+#include "storagepool.h"
+#include "common/jtimer.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace petabricks;
+
+/**
+ * Sums a block of rows of a matrix, one piece per worker task
+ */
+class Sweeper {
+public:
+  Sweeper(sequential::MatrixRegion2D m, int pieces) : _m(m), _sums(pieces), _pieces(pieces) {}
+
+  void sweep(int piece){
+    IndexT begin = _m.size(1)*piece/_pieces;
+    IndexT end   = _m.size(1)*(piece+1)/_pieces;
+    ElementT sum = 0;
+    for(IndexT y=begin; y<end; ++y)
+      for(IndexT x=0; x<_m.size(0); ++x)
+        sum += _m.cell(x,y);
+    _sums[piece] = sum;
+  }
+
+  void fill(int piece){
+    IndexT begin = _m.size(1)*piece/_pieces;
+    IndexT end   = _m.size(1)*(piece+1)/_pieces;
+    for(IndexT y=begin; y<end; ++y)
+      for(IndexT x=0; x<_m.size(0); ++x)
+        _m.cell(x,y) = x+y;
+  }
+private:
+  sequential::MatrixRegion2D _m;
+  std::vector<ElementT> _sums;
+  int _pieces;
+};
+
+static void bench(const char* policy, int n, int pieces, int sweeps) {
+  JASSERT(MatrixAllocator::setPolicy(policy))(policy);
+  std::vector<DynamicTaskPtr> tasks;
+  jalib::JTime t1 = jalib::JTime::now();
+  sequential::MatrixRegion2D a = sequential::MatrixRegion2D::allocate(n,n);
+  Sweeper s(a, pieces);
+  spawnMatrixIOPieces<Sweeper, &Sweeper::fill>(s, pieces, tasks);
+  waitMatrixIOPieces(tasks);
+  jalib::JTime t2 = jalib::JTime::now();
+  for(int i=0; i<sweeps; ++i){
+    spawnMatrixIOPieces<Sweeper, &Sweeper::sweep>(s, pieces, tasks);
+    waitMatrixIOPieces(tasks);
+  }
+  jalib::JTime t3 = jalib::JTime::now();
+  double mb = (double)n*n*sizeof(ElementT)/(1024.0*1024.0);
+  printf("%12s %9.1f MB   alloc+fill %9.1f ms   sweep %9.1f MB/s\n",
+         policy, mb, 1000.0*(t2-t1), sweeps*mb/(t3-t2));
+}
+
+///
+/// Allocate and free the temporaries a recursive transform would, with
+/// the storage pool limited to limitMB
+static void recycle(int n, int reps, size_t limitMB) {
+  StoragePool::setLimit(limitMB*1024*1024);
+  jalib::JTime t1 = jalib::JTime::now();
+  for(int r=0; r<reps; ++r){
+    std::vector<sequential::MatrixRegion1D> levels;
+    for(IndexT s=n; s>=64; s/=2){
+      levels.push_back(sequential::MatrixRegion1D::allocate(s));
+      levels.back().cell(0) = s;
+    }
+  }
+  jalib::JTime t2 = jalib::JTime::now();
+  printf("%9d MB pool   %d recursive allocations   %9.1f ms\n",
+         (int)limitMB, reps, 1000.0*(t2-t1));
+}
+
+static void* cacheAndExit(void*) {
+  for(int i=0; i<8; ++i)
+    StoragePool::release(StoragePool::allocate(64*1024<<i));
+  return NULL;
+}
+
+///
+/// Blocks cached by a thread must be freed when it exits
+static void threadExitCheck() {
+  StoragePool::setLimit(256*1024*1024);
+  size_t before = StoragePool::retained();
+  pthread_t th;
+  JASSERT(pthread_create(&th, NULL, &cacheAndExit, NULL)==0);
+  JASSERT(pthread_join(th, NULL)==0);
+  JASSERT(StoragePool::retained()==before)(StoragePool::retained())(before);
+  printf("thread exit releases its cache: ok\n");
+}
+
+int main(int argc, const char** argv){
+  int n = argc>1 ? atoi(argv[1]) : 4096;
+  int threads = argc>2 ? atoi(argv[2]) : 1;
+  int sweeps = 10;
+  DynamicScheduler::cpuScheduler().startWorkerThreads(threads);
+  //measure the policies themselves, not buffers recycled by the pool
+  StoragePool::setLimit(0);
+  const char* policies[] = { "heap", "thp", "hugetlb", "firsttouch", "interleave" };
+  for(size_t i=0; i<sizeof policies / sizeof policies[0]; ++i)
+    bench(policies[i], n, 4*threads, sweeps);
+  MatrixAllocator::dumpStats(std::cout);
+  std::cout << std::endl;
+  recycle(n*n, 100, 0);
+  recycle(n*n, 100, 256);
+  threadExitCheck();
+  StoragePool::dumpStats(std::cout);
+  std::cout << std::endl;
+  _exit(0);
+}
+
+petabricks::PetabricksRuntime::Main* petabricksMainTransform(){
+  return NULL;
+}
+petabricks::PetabricksRuntime::Main* petabricksFindTransform(const std::string& ){
+  return NULL;
+}
+void _petabricksInit() {}
+void _petabricksCleanup() {}
@@ -0,0 +1,112 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "petabricks.h"
+#include "common/jtimer.h"
+
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace petabricks;
+
+static double fileMegabytes(const char* filename) {
+  struct stat st;
+  JASSERT(stat(filename, &st)==0)(filename)(JASSERT_ERRNO);
+  return st.st_size / (1024.0*1024.0);
+}
+
+static ElementT touch(sequential::MatrixRegion2D m) {
+  ElementT sum = 0;
+  for(IndexT y=0; y<m.size(1); ++y)
+    for(IndexT x=0; x<m.size(0); ++x)
+      sum += m.cell(x,y);
+  return sum;
+}
+
+static void bench(const char* name, const char* filename, sequential::MatrixRegion2D a, bool exact) {
+  jalib::JTime t1 = jalib::JTime::now();
+  MatrixIOGeneral(filename, "w").write(a);
+  jalib::JTime t2 = jalib::JTime::now();
+  sequential::MatrixRegion2D b = MatrixIOGeneral(filename, "r").read_sequential<2>();
+  jalib::JTime t3 = jalib::JTime::now();
+  ElementT sum = touch(b);
+  jalib::JTime t4 = jalib::JTime::now();
+
+  double mb = fileMegabytes(filename);
+  printf("%8s %9.1f MB   write %9.1f MB/s   read %9.1f MB/s   read+touch %9.1f MB/s\n",
+         name, mb, mb/(t2-t1), mb/(t3-t2), mb/(t4-t2));
+  if(exact) {
+    JASSERT(sum == touch(a))(sum).Text("binary round trip changed the matrix");
+  }
+  unlink(filename);
+}
+
+//text io from a thread that is not a worker must not try to spawn tasks
+static void* textRoundTrip(void* arg) {
+  sequential::MatrixRegion2D& a = *(sequential::MatrixRegion2D*)arg;
+  const char* filename = "/tmp/matrixiobench.thread.txt";
+  MatrixIOGeneral(filename, "w").write(a);
+  sequential::MatrixRegion2D b = MatrixIOGeneral(filename, "r").read_sequential<2>();
+  JASSERT(b.size(0)==a.size(0) && b.size(1)==a.size(1));
+  for(IndexT y=0; y<a.size(1); ++y)
+    for(IndexT x=0; x<a.size(0); ++x)
+      JASSERT(b.cell(x,y) == a.cell(x,y))(x)(y).Text("text round trip changed the matrix");
+  unlink(filename);
+  return NULL;
+}
+
+static void nonWorkerCheck() {
+  sequential::MatrixRegion2D a = sequential::MatrixRegion2D::allocate(300, 200);
+  for(IndexT y=0; y<a.size(1); ++y)
+    for(IndexT x=0; x<a.size(0); ++x)
+      a.cell(x,y) = x + 1000*y;
+  pthread_t t;
+  JASSERT(pthread_create(&t, NULL, textRoundTrip, &a)==0);
+  JASSERT(pthread_join(t, NULL)==0);
+  printf("text io from a non-worker thread: ok\n");
+}
+
+int main(int argc, const char** argv){
+  int n = argc>1 ? atoi(argv[1]) : 2048;
+  int threads = argc>2 ? atoi(argv[2]) : 1;
+  DynamicScheduler::cpuScheduler().startWorkerThreads(threads);
+  sequential::MatrixRegion2D a = sequential::MatrixRegion2D::allocate(n,n);
+  nonWorkerCheck();
+  a.randomize();
+  bench("text",   "/tmp/matrixiobench.txt",   a, false);
+  bench("binary", "/tmp/matrixiobench.pbmat", a, true);
+  return 0;
+}
+
+petabricks::PetabricksRuntime::Main* petabricksMainTransform(){
+  return NULL;
+}
+petabricks::PetabricksRuntime::Main* petabricksFindTransform(const std::string& ){
+  return NULL;
+}
+void _petabricksInit() {}
+void _petabricksCleanup() {}
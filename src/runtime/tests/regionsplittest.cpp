@@ -0,0 +1,114 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "petabricks.h"
+
+#include "regionmatrix.h"
+
+#include <math.h>
+
+using namespace petabricks;
+using namespace petabricks::distributed;
+
+PetabricksRuntime::Main* petabricksMainTransform(){
+  return NULL;
+}
+PetabricksRuntime::Main* petabricksFindTransform(const std::string& ){
+  return NULL;
+}
+void _petabricksInit() {}
+void _petabricksCleanup() {}
+
+///
+/// A matrix split into parts that all live in this process, so none of
+/// this needs a remote host
+static MatrixRegion3D localSplit(IndexT* size, IndexT* splitSize) {
+  MatrixRegion3D m(size);
+  m.splitData(splitSize);
+  int parts = 1;
+  for(int d=0; d<3; ++d)
+    parts *= (size[d]+splitSize[d]-1)/splitSize[d];
+  for(int i=0; i<parts; ++i)
+    m.createDataPart(i, NULL);
+  m.allocDataLocal();
+  return m;
+}
+
+static void snapshot(MatrixRegion3D& m, std::vector<ElementT>& out) {
+  out.clear();
+  IndexT c[3];
+  for(c[2]=0; c[2]<m.size(2); ++c[2])
+    for(c[1]=0; c[1]<m.size(1); ++c[1])
+      for(c[0]=0; c[0]<m.size(0); ++c[0])
+        out.push_back(m.cell(c));
+}
+
+///
+/// randomize(r) on a split goes to every part, and a given stream always
+/// produces the same matrix
+static void splitRandomize(MatrixRegion3D& m) {
+  std::vector<ElementT> a, b;
+  m.regionHandler()->randomize(CounterRandom(42, 7));
+  snapshot(m, a);
+  m.randomize();
+  m.regionHandler()->randomize(CounterRandom(42, 7));
+  snapshot(m, b);
+  JASSERT(a == b);
+
+  //parts draw from different streams
+  IndexT p0[] = {0,0,0};
+  IndexT p1[] = {2,0,0};
+  JASSERT(m.cell(p0) != m.cell(p1))(m.cell(p0));
+  printf("split randomize(r): ok\n");
+}
+
+///
+/// A scratch copy of data that sits in a single local part aliases it
+/// instead of copying
+static void localScratchAlias(MatrixRegion3D& m) {
+  IndexT m0[] = {0,0,0};
+  IndexT m2[] = {2,2,2};
+  IndexT m4[] = {4,4,4};
+  IndexT m123[] = {1,2,3};
+  IndexT m456[] = {4,5,6};
+  MatrixRegion3D inPart = m.region(m2, m4);
+  MatrixRegion3D acrossParts = m.region(m123, m456);
+  JASSERT(inPart.isAliasable());
+  JASSERT(!acrossParts.isAliasable());
+  MatrixRegion3D alias = inPart.localScratch(false);
+  alias.cell(m0) = 7;
+  JASSERT(fabs(m.cell(m2) - 7) < 0.00000001)(m.cell(m2));
+  printf("localScratch aliases a single local part: ok\n");
+}
+
+int main(int, const char**){
+  IndexT size[] = {8,9,8};
+  IndexT m2[] = {2,2,2};
+  MatrixRegion3D m = localSplit(size, m2);
+  splitRandomize(m);
+  localScratchAlias(m);
+  return 0;
+}
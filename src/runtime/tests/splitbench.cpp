@@ -0,0 +1,225 @@
+/*****************************************************************************
+ *  Copyright (C) 2008-2011 Massachusetts Institute of Technology            *
+ *                                                                           *
+ *  Permission is hereby granted, free of charge, to any person obtaining    *
+ *  a copy of this software and associated documentation files (the          *
+ *  "Software"), to deal in the Software without restriction, including      *
+ *  without limitation the rights to use, copy, modify, merge, publish,      *
+ *  distribute, sublicense, and/or sell copies of the Software, and to       *
+ *  permit persons to whom the Software is furnished to do so, subject       *
+ *  to the following conditions:                                             *
+ *                                                                           *
+ *  The above copyright notice and this permission notice shall be included  *
+ *  in all copies or substantial portions of the Software.                   *
+ *                                                                           *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY                *
+ *  KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE               *
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND      *
+ *  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   *
+ *  LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   *
+ *  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    *
+ *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE           *
+ *                                                                           *
+ *  This source code is part of the PetaBricks project:                      *
+ *    http://projects.csail.mit.edu/petabricks/                              *
+ *                                                                           *
+ *****************************************************************************/
+#include "petabricks.h"
+
+#include "common/jtimer.h"
+
+#include <unistd.h>
+
+using namespace petabricks;
+
+/**
+ * Splits a 2D iteration space the way the split code pbc generates for a
+ * single element rule does, to measure what each split fan-out,
+ * recursive bisection and wavefront tile size cost in task overhead and
+ * buy in parallel speedup on this machine
+ */
+class SplitBench : public jalib::JRefCounted {
+public:
+  ///
+  /// work is the flops spent per cell, 0 leaves an empty rule body
+  SplitBench(sequential::MatrixRegion2D m, IndexT thresh, int blocks, int work)
+    : _m(m), _thresh(thresh), _blocks(blocks), _work(work), _tasks(0), _bisect(false)
+  {}
+
+  //mirrors apply_ruleN_workstealing
+  DynamicTaskPtr apply(IndexT begin[2], IndexT end[2]){
+    if(petabricks::split_condition<2>(_thresh, _blocks, begin, end)){
+      if(_bisect)
+        return bisect(begin, end);
+      switch(_blocks){
+        case 2: return split<2>(begin, end);
+        case 3: return split<3>(begin, end);
+        case 4: return split<4>(begin, end);
+        default: JASSERT(false)(_blocks);
+      }
+    }
+    if(_work==0)
+      return NULL;
+    for(IndexT y=begin[1]; y<end[1]; ++y)
+      for(IndexT x=begin[0]; x<end[0]; ++x){
+        ElementT v = x+y;
+        for(int i=0; i<_work; ++i)
+          v = v*0.5 + 1.0;
+        _m.cell(x,y) = v;
+      }
+    return NULL;
+  }
+
+  long tasks() const { return _tasks; }
+  void setBisect(bool b) { _bisect = b; }
+private:
+  //mirrors IterationDefinition::genBisectCode
+  DynamicTaskPtr bisect(IndexT begin[2], IndexT end[2]){
+    __sync_fetch_and_add(&_tasks, 2);
+    int d = petabricks::longest_dimension<2>(begin, end);
+    IndexT hi[2] = { end[0], end[1] };
+    IndexT lo[2] = { begin[0], begin[1] };
+    hi[d] = lo[d] = begin[d] + (end[d]-begin[d])/2;
+    GroupedDynamicTask<2>* _split_task = new GroupedDynamicTask<2>();
+    (*_split_task)[0] = new SpatialMethodCallTask<SplitBench, 2, &SplitBench::apply>(this, begin, hi);
+    (*_split_task)[1] = new SpatialMethodCallTask<SplitBench, 2, &SplitBench::apply>(this, lo, end);
+    return petabricks::run_task(_split_task);
+  }
+
+  //mirrors IterationDefinition::genSplitCode for independent blocks
+  template<int N>
+  DynamicTaskPtr split(IndexT begin[2], IndexT end[2]){
+    __sync_fetch_and_add(&_tasks, N*N);
+    GroupedDynamicTask<N*N>* _split_task = new GroupedDynamicTask<N*N>();
+    for(int by=0; by<N; ++by){
+      for(int bx=0; bx<N; ++bx){
+        IndexT b[2], e[2];
+        b[0] = begin[0] + (end[0]-begin[0])/N*bx;
+        b[1] = begin[1] + (end[1]-begin[1])/N*by;
+        e[0] = bx+1==N ? end[0] : begin[0] + (end[0]-begin[0])/N*(bx+1);
+        e[1] = by+1==N ? end[1] : begin[1] + (end[1]-begin[1])/N*(by+1);
+        (*_split_task)[bx+by*N] = new SpatialMethodCallTask<SplitBench, 2, &SplitBench::apply>(this, b, e);
+      }
+    }
+    return petabricks::run_task(_split_task);
+  }
+
+  sequential::MatrixRegion2D _m;
+  IndexT _thresh;
+  int _blocks;
+  int _work;
+  long _tasks;
+  bool _bisect;
+};
+
+///
+/// blocks==0 selects recursive bisection
+static double timeit(sequential::MatrixRegion2D m, IndexT thresh, int blocks, int work, int reps, long& tasks){
+  jalib::JRef<SplitBench> bench = new SplitBench(m, thresh, blocks>0 ? blocks : 2, work);
+  bench->setBisect(blocks==0);
+  IndexT begin[2] = { 0, 0 };
+  IndexT end[2] = { m.size(0), m.size(1) };
+  jalib::JTime t1 = jalib::JTime::now();
+  for(int r=0; r<reps; ++r){
+    DynamicTaskPtr t = new SpatialMethodCallTask<SplitBench, 2, &SplitBench::apply>(bench, begin, end);
+    enqueue_and_wait(t);
+  }
+  jalib::JTime t2 = jalib::JTime::now();
+  tasks = bench->tasks()/reps;
+  return 1000.0*(t2-t1)/reps;
+}
+
+/**
+ * A self dependent rule, each cell depends on its left and upper
+ * neighbours like a dynamic programming table, split into a wavefront
+ */
+class WavefrontBench : public jalib::JRefCounted {
+public:
+  WavefrontBench(sequential::MatrixRegion2D m, IndexT tile) : _m(m), _tile(tile) {}
+
+  //mirrors apply_ruleN_workstealing with a wavefront split
+  DynamicTaskPtr apply(IndexT begin[2], IndexT end[2]){
+    if(petabricks::wavefront_condition<2>(_tile, begin, end)){
+      const int _wavefront_dir[] = {1, 1};
+      return petabricks::spawn_wavefront<WavefrontBench, 2, &WavefrontBench::apply>(this, begin, end, _tile, _wavefront_dir);
+    }
+    for(IndexT y=std::max<IndexT>(begin[1], 1); y<end[1]; ++y)
+      for(IndexT x=std::max<IndexT>(begin[0], 1); x<end[0]; ++x)
+        _m.cell(x,y) = 0.5*(_m.cell(x-1,y) + _m.cell(x,y-1)) + 1.0;
+    return NULL;
+  }
+private:
+  sequential::MatrixRegion2D _m;
+  IndexT _tile;
+};
+
+///
+/// tile==0 runs the rule without a wavefront
+static double timewavefront(sequential::MatrixRegion2D m, IndexT tile, int reps){
+  jalib::JRef<WavefrontBench> bench = new WavefrontBench(m, tile);
+  IndexT begin[2] = { 0, 0 };
+  IndexT end[2] = { m.size(0), m.size(1) };
+  jalib::JTime t1 = jalib::JTime::now();
+  for(int r=0; r<reps; ++r){
+    for(IndexT i=0; i<m.size(0); ++i)
+      m.cell(i,0) = i;
+    for(IndexT i=0; i<m.size(1); ++i)
+      m.cell(0,i) = i;
+    DynamicTaskPtr t = new SpatialMethodCallTask<WavefrontBench, 2, &WavefrontBench::apply>(bench, begin, end);
+    enqueue_and_wait(t);
+  }
+  jalib::JTime t2 = jalib::JTime::now();
+  return 1000.0*(t2-t1)/reps;
+}
+
+int main(int argc, const char** argv){
+  int n = argc>1 ? atoi(argv[1]) : 2048;
+  int threads = argc>2 ? atoi(argv[2]) : 4;
+  IndexT splitsize = argc>3 ? atoi(argv[3]) : 64;
+  int work = 8;
+  int reps = 5;
+  DynamicScheduler::cpuScheduler().startWorkerThreads(threads);
+  sequential::MatrixRegion2D m = sequential::MatrixRegion2D::allocate(n,n);
+  long tasks;
+  //a threshold of n+1 never splits
+  double unsplit = timeit(m, n+1, 2, work, reps, tasks);
+  printf("%dx%d   %d threads   splitsize %d   unsplit %9.2f ms\n", n, n, threads, (int)splitsize, unsplit);
+  for(int blocks=0; blocks<=4; ++blocks){
+    if(blocks==1)
+      continue;
+    long emptyTasks;
+    double t = timeit(m, splitsize, blocks, work, reps, tasks);
+    //empty rule bodies leave only the cost of splitting
+    double overhead = timeit(m, splitsize, blocks, 0, reps, emptyTasks);
+    if(blocks==0)
+      printf("bisect        ");
+    else
+      printf("blocknumber %d ", blocks);
+    printf("  %8ld tasks   %9.2f ms   speedup %5.2fx   split overhead %6.3f us/task\n",
+           tasks, t, unsplit/t, 1000.0*overhead/std::max(emptyTasks, 1L));
+  }
+
+  sequential::MatrixRegion2D expected = sequential::MatrixRegion2D::allocate(n,n);
+  double serial = timewavefront(expected, 0, reps);
+  printf("wavefront     serial %9.2f ms\n", serial);
+  for(IndexT tile=64; tile<=512; tile*=2){
+    double t = timewavefront(m, tile, reps);
+    bool same = true;
+    for(IndexT y=0; y<n && same; ++y)
+      for(IndexT x=0; x<n && same; ++x)
+        same = m.cell(x,y) == expected.cell(x,y);
+    printf("wavefront %4d   %9.2f ms   speedup %5.2fx   %s\n",
+           (int)tile, t, serial/t, same ? "matches serial" : "MISMATCH");
+  }
+  fflush(stdout);
+  _exit(0);
+}
+
+petabricks::PetabricksRuntime::Main* petabricksMainTransform(){
+  return NULL;
+}
+petabricks::PetabricksRuntime::Main* petabricksFindTransform(const std::string& ){
+  return NULL;
+}
+void _petabricksInit() {}
+void _petabricksCleanup() {}